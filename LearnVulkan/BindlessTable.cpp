@@ -0,0 +1,164 @@
+#include "BindlessTable.h"
+
+#include <stdexcept>
+
+uint32_t BindlessTable::Slots::allocate()
+{
+	if (!m_free.empty())
+	{
+		uint32_t handle = m_free.back();
+		m_free.pop_back();
+		return handle;
+	}
+	if (m_next == m_capacity)
+	{
+		throw std::runtime_error("bindless descriptor array is full!");
+	}
+	return m_next++;
+}
+
+void BindlessTable::Slots::release(uint32_t handle)
+{
+	if (handle < m_next)
+	{
+		m_free.push_back(handle);
+	}
+}
+
+void BindlessTable::init(VkDevice device, uint32_t imageCapacity, uint32_t bufferCapacity)
+{
+	m_device = device;
+	m_images = Slots();
+	m_images.m_capacity = imageCapacity;
+	m_buffers = Slots();
+	m_buffers.m_capacity = bufferCapacity;
+
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	bindings[0].binding = IMAGE_BINDING;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = imageCapacity;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+	bindings[1].binding = BUFFER_BINDING;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = bufferCapacity;
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+	// 没有注册的下标保持未写入，只要着色器不访问就是合法的；
+	// 命令缓冲在执行时可以更新它没有用到的下标
+	VkDescriptorBindingFlags bindingFlags[2];
+	bindingFlags[0] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+	bindingFlags[1] = bindingFlags[0];
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 2;
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = imageCapacity;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = bufferCapacity;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_layout;
+
+	if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate bindless descriptor set!");
+	}
+}
+
+void BindlessTable::destroy()
+{
+	// 描述符集随池一起释放
+	vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+	m_pool = VK_NULL_HANDLE;
+	m_layout = VK_NULL_HANDLE;
+	m_descriptorSet = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessTable::addImage(VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+{
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+	imageInfo.imageLayout = layout;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32_t handle = m_images.allocate();
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_descriptorSet;
+	write.dstBinding = IMAGE_BINDING;
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+	return handle;
+}
+
+uint32_t BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32_t handle = m_buffers.allocate();
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_descriptorSet;
+	write.dstBinding = BUFFER_BINDING;
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+	return handle;
+}
+
+void BindlessTable::releaseImage(uint32_t handle)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_images.release(handle);
+}
+
+void BindlessTable::releaseBuffer(uint32_t handle)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_buffers.release(handle);
+}
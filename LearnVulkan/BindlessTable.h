@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * \brief 无绑定描述符表
+ *
+ * 一个描述符集中有两个很大的数组：组合图像采样器和存储缓冲。资源注册时分配一个数组下标作为句柄，
+ * 着色器通过推送常量拿到句柄后直接索引数组（见bindless.glsl）。描述符集在每个命令缓冲开始时绑定一次，
+ * 切换材质不再需要重新绑定描述符集，使用不同纹理的绘制也可以合并。
+ *
+ * 数组使用VK_EXT_descriptor_indexing（Vulkan 1.2核心）的绑定后更新和部分绑定，
+ * 注册新资源时不需要等待正在执行的帧。
+ */
+class BindlessTable
+{
+public:
+	// 与bindless.glsl中的声明一致
+	static const uint32_t IMAGE_BINDING = 0;
+	static const uint32_t BUFFER_BINDING = 1;
+
+	// 无效的句柄
+	static const uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	BindlessTable() = default;
+
+	BindlessTable(const BindlessTable&) = delete;
+	BindlessTable& operator=(const BindlessTable&) = delete;
+
+	/**
+	 * \brief 创建描述符集布局、描述符池和唯一的描述符集
+	 * \param device 必须启用了描述符索引的相关特性
+	 * \param imageCapacity 图像数组的大小，不能超过设备的绑定后更新限制
+	 * \param bufferCapacity 缓冲数组的大小，不能超过设备的绑定后更新限制
+	 */
+	void init(VkDevice device, uint32_t imageCapacity, uint32_t bufferCapacity);
+
+	/**
+	 * \brief 销毁所有对象，调用前设备应该已经空闲
+	 */
+	void destroy();
+
+	/**
+	 * \brief 注册一个图像
+	 * \param imageView
+	 * \param sampler
+	 * \param layout 着色器访问时图像所处的布局
+	 * \return 图像数组的下标，数组已满时抛出异常
+	 */
+	uint32_t addImage(VkImageView imageView, VkSampler sampler, VkImageLayout layout);
+
+	/**
+	 * \brief 注册一个存储缓冲
+	 * \param buffer 必须带有VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+	 * \param offset
+	 * \param range
+	 * \return 缓冲数组的下标，数组已满时抛出异常
+	 */
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+	/**
+	 * \brief 释放句柄，下标可以被之后注册的资源复用
+	 *
+	 * 飞行中的帧可能还在使用这个下标，通常通过延迟删除队列在帧完成后调用。
+	 * \param handle
+	 */
+	void releaseImage(uint32_t handle);
+	void releaseBuffer(uint32_t handle);
+
+	VkDescriptorSetLayout getLayout() const
+	{
+		return m_layout;
+	}
+
+	VkDescriptorSet getDescriptorSet() const
+	{
+		return m_descriptorSet;
+	}
+
+	uint32_t getImageCapacity() const
+	{
+		return m_images.m_capacity;
+	}
+
+	uint32_t getBufferCapacity() const
+	{
+		return m_buffers.m_capacity;
+	}
+
+private:
+	/**
+	 * \brief 一个数组的下标分配
+	 */
+	struct Slots
+	{
+		uint32_t m_capacity = 0;
+
+		// 从未使用过的最小下标
+		uint32_t m_next = 0;
+
+		// 释放后可以复用的下标
+		std::vector<uint32_t> m_free;
+
+		uint32_t allocate();
+
+		void release(uint32_t handle);
+	};
+
+	VkDevice m_device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+	VkDescriptorPool m_pool = VK_NULL_HANDLE;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+	// 保护下标分配，同一个描述符集的更新也需要外部同步
+	std::mutex m_mutex;
+
+	Slots m_images;
+	Slots m_buffers;
+};
@@ -0,0 +1,139 @@
+#include "CpuTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "Json.h"
+
+namespace
+{
+	// 每个线程保留的事件数
+	const size_t EVENTS_PER_THREAD = 1 << 16;
+
+	struct TraceEvent
+	{
+		const char* m_name;
+		uint64_t m_begin;
+		uint64_t m_end;
+	};
+
+	/**
+	 * \brief 一个线程独占的环形缓冲
+	 */
+	struct ThreadBuffer
+	{
+		uint32_t m_threadId = 0;
+		std::string m_name;
+		std::vector<TraceEvent> m_events;
+
+		// 累计写入的事件数，只由所属线程递增
+		std::atomic<uint64_t> m_written{ 0 };
+	};
+
+	std::atomic<bool> g_enabled{ false };
+
+	const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+	// 所有线程的缓冲，线程退出后也保留到导出
+	std::mutex g_buffersMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+
+	/**
+	 * \brief 当前线程的缓冲，第一次调用时注册
+	 * \return
+	 */
+	ThreadBuffer& getThreadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer());
+			newBuffer->m_events.resize(EVENTS_PER_THREAD);
+
+			std::lock_guard<std::mutex> lock(g_buffersMutex);
+			newBuffer->m_threadId = static_cast<uint32_t>(g_buffers.size()) + 1;
+			buffer = newBuffer.get();
+			g_buffers.push_back(std::move(newBuffer));
+		}
+		return *buffer;
+	}
+}
+
+void CpuTrace::setEnabled(bool enabled)
+{
+	g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool CpuTrace::isEnabled()
+{
+	return g_enabled.load(std::memory_order_relaxed);
+}
+
+void CpuTrace::setThreadName(const std::string& name)
+{
+	getThreadBuffer().m_name = name;
+}
+
+uint64_t CpuTrace::now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count());
+}
+
+void CpuTrace::record(const char* name, uint64_t begin, uint64_t end)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	uint64_t index = buffer.m_written.load(std::memory_order_relaxed);
+
+	TraceEvent& event = buffer.m_events[index % EVENTS_PER_THREAD];
+	event.m_name = name;
+	event.m_begin = begin;
+	event.m_end = end;
+
+	buffer.m_written.store(index + 1, std::memory_order_release);
+}
+
+void CpuTrace::writeChromeTrace(const std::string& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	std::lock_guard<std::mutex> lock(g_buffersMutex);
+
+	// 时间单位为微秒，保留到纳秒
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const auto& buffer : g_buffers)
+	{
+		if (!buffer->m_name.empty())
+		{
+			file << (first ? "\n" : ",\n")
+				<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->m_threadId
+				<< ",\"args\":{\"name\":\"" << escapeJson(buffer->m_name) << "\"}}";
+			first = false;
+		}
+
+		// 写满之后只有最近的EVENTS_PER_THREAD个事件仍然有效
+		uint64_t written = buffer->m_written.load(std::memory_order_acquire);
+		uint64_t begin = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+		for (uint64_t i = begin; i < written; i++)
+		{
+			const TraceEvent& event = buffer->m_events[i % EVENTS_PER_THREAD];
+			file << (first ? "\n" : ",\n")
+				<< "{\"name\":\"" << escapeJson(event.m_name) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->m_threadId
+				<< ",\"ts\":" << event.m_begin / 1000.0 << ",\"dur\":" << (event.m_end - event.m_begin) / 1000.0 << "}";
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief CPU时间线记录，导出为Chrome的trace_event格式
+ *
+ * 每个线程第一次记录时分配自己的环形缓冲，之后写入不需要加锁，
+ * 缓冲写满后覆盖最旧的事件。导出结果可以在chrome://tracing或Perfetto中打开。
+ */
+class CpuTrace
+{
+public:
+	/**
+	 * \brief 开启或关闭记录，关闭时计时作用域只做一次判断
+	 * \param enabled
+	 */
+	static void setEnabled(bool enabled);
+
+	static bool isEnabled();
+
+	/**
+	 * \brief 设置当前线程在时间线中显示的名称
+	 * \param name
+	 */
+	static void setThreadName(const std::string& name);
+
+	/**
+	 * \brief 当前时刻，单位纳秒，以程序启动为零点
+	 * \return
+	 */
+	static uint64_t now();
+
+	/**
+	 * \brief 记录一个已经结束的事件
+	 * \param name 必须在程序运行期间保持有效，通常是字符串字面量
+	 * \param begin 开始时刻，由now()得到
+	 * \param end 结束时刻，由now()得到
+	 */
+	static void record(const char* name, uint64_t begin, uint64_t end);
+
+	/**
+	 * \brief 把所有线程的事件写成trace_event JSON，调用时其他线程不应该再记录
+	 * \param path
+	 */
+	static void writeChromeTrace(const std::string& path);
+};
+
+/**
+ * \brief 在析构时记录从构造到析构的耗时
+ */
+class CpuTraceScope
+{
+public:
+	explicit CpuTraceScope(const char* name)
+		: m_name(name), m_enabled(CpuTrace::isEnabled()), m_begin(m_enabled ? CpuTrace::now() : 0)
+	{
+	}
+
+	~CpuTraceScope()
+	{
+		if (m_enabled)
+		{
+			CpuTrace::record(m_name, m_begin, CpuTrace::now());
+		}
+	}
+
+	CpuTraceScope(const CpuTraceScope&) = delete;
+	CpuTraceScope& operator=(const CpuTraceScope&) = delete;
+
+private:
+	const char* m_name;
+	bool m_enabled;
+	uint64_t m_begin;
+};
@@ -0,0 +1,32 @@
+#include "DeletionQueue.h"
+
+#include <utility>
+
+void DeletionQueue::push(uint64_t frameNumber, std::function<void()> deleter)
+{
+	Entry entry;
+	entry.m_frameNumber = frameNumber;
+	entry.m_deleter = std::move(deleter);
+	m_entries.push_back(std::move(entry));
+}
+
+void DeletionQueue::flush(uint64_t completedFrame)
+{
+	// 帧序号单调递增，遇到第一个未完成的就可以停止
+	while (!m_entries.empty() && m_entries.front().m_frameNumber <= completedFrame)
+	{
+		std::function<void()> deleter = std::move(m_entries.front().m_deleter);
+		m_entries.pop_front();
+		deleter();
+	}
+}
+
+void DeletionQueue::flushAll()
+{
+	while (!m_entries.empty())
+	{
+		std::function<void()> deleter = std::move(m_entries.front().m_deleter);
+		m_entries.pop_front();
+		deleter();
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+/**
+ * \brief 延迟删除队列
+ *
+ * 仍可能被飞行中的帧使用的对象不能立即销毁。退役时记下当前的帧序号，
+ * 等这一帧确认完成后再执行销毁，避免为了替换对象而调用vkDeviceWaitIdle。
+ */
+class DeletionQueue
+{
+public:
+	/**
+	 * \brief 登记一个销毁操作
+	 * \param frameNumber 最后可能使用该对象的帧序号
+	 * \param deleter
+	 */
+	void push(uint64_t frameNumber, std::function<void()> deleter);
+
+	/**
+	 * \brief 执行所有已经安全的销毁操作
+	 * \param completedFrame 已经确认在GPU上完成的最大帧序号
+	 */
+	void flush(uint64_t completedFrame);
+
+	/**
+	 * \brief 执行全部销毁操作，调用前设备应该已经空闲
+	 */
+	void flushAll();
+
+	/**
+	 * \brief 等待执行的销毁操作数量
+	 * \return
+	 */
+	size_t size() const
+	{
+		return m_entries.size();
+	}
+
+private:
+	struct Entry
+	{
+		uint64_t m_frameNumber = 0;
+		std::function<void()> m_deleter;
+	};
+
+	// 按帧序号递增排列
+	std::deque<Entry> m_entries;
+};
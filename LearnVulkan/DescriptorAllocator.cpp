@@ -0,0 +1,325 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Hash.h"
+
+namespace
+{
+	// 每个描述符集平均需要的各类描述符数，池的容量按它乘以描述符集数计算
+	const VkDescriptorPoolSize POOL_RATIOS[] =
+	{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+	};
+
+	// 第一个池的描述符集数，之后每个新池翻倍，直到上限
+	const uint32_t INITIAL_POOL_SETS = 64;
+	const uint32_t MAX_POOL_SETS = 4096;
+
+	/**
+	 * \brief 判断描述符类型是否使用缓冲信息
+	 * \param type
+	 * \return
+	 */
+	bool isBufferDescriptor(VkDescriptorType type)
+	{
+		return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+			type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	}
+}
+
+void DescriptorSetContents::bindBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	Binding& entry = findOrInsert(binding);
+	entry.m_type = type;
+	entry.m_buffer.buffer = buffer;
+	entry.m_buffer.offset = offset;
+	entry.m_buffer.range = range;
+	entry.m_image = VkDescriptorImageInfo();
+}
+
+void DescriptorSetContents::bindImage(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+{
+	Binding& entry = findOrInsert(binding);
+	entry.m_type = type;
+	entry.m_image.imageView = imageView;
+	entry.m_image.sampler = sampler;
+	entry.m_image.imageLayout = layout;
+	entry.m_buffer = VkDescriptorBufferInfo();
+}
+
+DescriptorSetContents::Binding& DescriptorSetContents::findOrInsert(uint32_t binding)
+{
+	auto it = std::lower_bound(m_bindings.begin(), m_bindings.end(), binding,
+		[](const Binding& entry, uint32_t value) { return entry.m_binding < value; });
+	if (it == m_bindings.end() || it->m_binding != binding)
+	{
+		it = m_bindings.insert(it, Binding());
+		it->m_binding = binding;
+	}
+	return *it;
+}
+
+void DescriptorSetContents::write(VkDevice device, VkDescriptorSet descriptorSet) const
+{
+	std::vector<VkWriteDescriptorSet> writes(m_bindings.size());
+	for (size_t i = 0; i < m_bindings.size(); i++)
+	{
+		const Binding& binding = m_bindings[i];
+		VkWriteDescriptorSet& write = writes[i];
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = binding.m_binding;
+		write.descriptorCount = 1;
+		write.descriptorType = binding.m_type;
+		if (isBufferDescriptor(binding.m_type))
+		{
+			write.pBufferInfo = &binding.m_buffer;
+		}
+		else
+		{
+			write.pImageInfo = &binding.m_image;
+		}
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+uint64_t DescriptorSetContents::hash(uint64_t seed) const
+{
+	for (const auto& binding : m_bindings)
+	{
+		seed = hashValue(binding.m_binding, seed);
+		seed = hashValue(binding.m_type, seed);
+		seed = hashValue(binding.m_buffer, seed);
+		seed = hashValue(binding.m_image.sampler, seed);
+		seed = hashValue(binding.m_image.imageView, seed);
+		seed = hashValue(binding.m_image.imageLayout, seed);
+	}
+	return seed;
+}
+
+bool DescriptorSetContents::operator==(const DescriptorSetContents& other) const
+{
+	if (m_bindings.size() != other.m_bindings.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < m_bindings.size(); i++)
+	{
+		const Binding& a = m_bindings[i];
+		const Binding& b = other.m_bindings[i];
+		if (a.m_binding != b.m_binding || a.m_type != b.m_type ||
+			a.m_buffer.buffer != b.m_buffer.buffer || a.m_buffer.offset != b.m_buffer.offset || a.m_buffer.range != b.m_buffer.range ||
+			a.m_image.sampler != b.m_image.sampler || a.m_image.imageView != b.m_image.imageView || a.m_image.imageLayout != b.m_image.imageLayout)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void DescriptorPoolGroup::init(VkDevice device)
+{
+	m_device = device;
+	m_nextPoolSets = INITIAL_POOL_SETS;
+}
+
+void DescriptorPoolGroup::destroy()
+{
+	for (auto pool : m_pools)
+	{
+		vkDestroyDescriptorPool(m_device, pool, nullptr);
+	}
+	m_pools.clear();
+	m_currentPool = 0;
+}
+
+VkDescriptorSet DescriptorPoolGroup::allocate(VkDescriptorSetLayout layout)
+{
+	for (;;)
+	{
+		bool newPool = m_currentPool == m_pools.size();
+		if (newPool)
+		{
+			createPool();
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_pools[m_currentPool];
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		VkDescriptorSet descriptorSet;
+		VkResult result = vkAllocateDescriptorSets(m_device, &allocInfo, &descriptorSet);
+		if (result == VK_SUCCESS)
+		{
+			m_allocatedSets++;
+			return descriptorSet;
+		}
+
+		// 新建的空池也放不下时说明布局需要的描述符超过了池的容量
+		if (newPool || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL))
+		{
+			throw std::runtime_error("failed to allocate descriptor set!");
+		}
+		m_currentPool++;
+	}
+}
+
+void DescriptorPoolGroup::reset()
+{
+	// 只重置用过的池，后面的池还是空的
+	for (size_t i = 0; i < m_pools.size() && i <= m_currentPool; i++)
+	{
+		vkResetDescriptorPool(m_device, m_pools[i], 0);
+	}
+	m_currentPool = 0;
+}
+
+void DescriptorPoolGroup::createPool()
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto& ratio : POOL_RATIOS)
+	{
+		poolSizes.push_back({ ratio.type, ratio.descriptorCount * m_nextPoolSets });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = m_nextPoolSets;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+
+	m_pools.push_back(pool);
+	m_nextPoolSets = std::min(m_nextPoolSets * 2, MAX_POOL_SETS);
+}
+
+size_t DescriptorAllocator::CacheKeyHash::operator()(const CacheKey& key) const
+{
+	return static_cast<size_t>(key.m_contents.hash(hashValue(key.m_layout, 14695981039346656037ull)));
+}
+
+void DescriptorAllocator::init(VkDevice device, uint32_t frameCount)
+{
+	m_device = device;
+	m_currentFrame = 0;
+
+	m_framePools.clear();
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		m_framePools.emplace_back(new DescriptorPoolGroup());
+		m_framePools.back()->init(device);
+	}
+	m_cachePools.init(device);
+}
+
+void DescriptorAllocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& pools : m_framePools)
+	{
+		pools->destroy();
+	}
+	m_framePools.clear();
+	m_cachePools.destroy();
+	m_cache.clear();
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_currentFrame = frameIndex;
+	m_framePools[frameIndex]->reset();
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_framePools[m_currentFrame]->allocate(layout);
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout, const DescriptorSetContents& contents)
+{
+	VkDescriptorSet descriptorSet = allocateTransient(layout);
+
+	// 不同的描述符集可以在多个线程上同时写入
+	contents.write(m_device, descriptorSet);
+	return descriptorSet;
+}
+
+VkDescriptorSet DescriptorAllocator::getCached(VkDescriptorSetLayout layout, const DescriptorSetContents& contents)
+{
+	CacheKey key;
+	key.m_layout = layout;
+	key.m_contents = contents;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_cache.find(key);
+	if (it != m_cache.end())
+	{
+		m_cacheHits++;
+		return it->second;
+	}
+
+	VkDescriptorSet descriptorSet = m_cachePools.allocate(layout);
+	contents.write(m_device, descriptorSet);
+	m_cache.emplace(std::move(key), descriptorSet);
+	return descriptorSet;
+}
+
+void DescriptorAllocator::resetCache()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_cachePools.reset();
+	m_cache.clear();
+}
+
+size_t DescriptorAllocator::getPoolCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t count = m_cachePools.getPoolCount();
+	for (const auto& pools : m_framePools)
+	{
+		count += pools->getPoolCount();
+	}
+	return count;
+}
+
+uint64_t DescriptorAllocator::getTransientSetCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint64_t count = 0;
+	for (const auto& pools : m_framePools)
+	{
+		count += pools->getAllocatedSetCount();
+	}
+	return count;
+}
+
+size_t DescriptorAllocator::getCachedSetCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cache.size();
+}
+
+uint64_t DescriptorAllocator::getCacheHitCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cacheHits;
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief 一个描述符集的全部内容，既用来写入描述符集，也是长期描述符集缓存的键
+ */
+class DescriptorSetContents
+{
+public:
+	/**
+	 * \brief 绑定一个缓冲，同一个绑定号重复设置时覆盖
+	 * \param binding
+	 * \param type 缓冲类的描述符类型
+	 * \param buffer
+	 * \param offset
+	 * \param range
+	 */
+	void bindBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+	/**
+	 * \brief 绑定一个图像或采样器，同一个绑定号重复设置时覆盖
+	 * \param binding
+	 * \param type 图像类或采样器的描述符类型
+	 * \param imageView
+	 * \param sampler
+	 * \param layout
+	 */
+	void bindImage(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout layout);
+
+	/**
+	 * \brief 把内容写入一个描述符集
+	 * \param device
+	 * \param descriptorSet
+	 */
+	void write(VkDevice device, VkDescriptorSet descriptorSet) const;
+
+	uint64_t hash(uint64_t seed) const;
+
+	bool operator==(const DescriptorSetContents& other) const;
+
+private:
+	struct Binding
+	{
+		uint32_t m_binding = 0;
+		VkDescriptorType m_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+		// 按类型只使用其中一个
+		VkDescriptorBufferInfo m_buffer = {};
+		VkDescriptorImageInfo m_image = {};
+	};
+
+	// 按绑定号递增排列
+	std::vector<Binding> m_bindings;
+
+	Binding& findOrInsert(uint32_t binding);
+};
+
+/**
+ * \brief 按需增长的一组描述符池，只能整体重置，不单独释放描述符集
+ */
+class DescriptorPoolGroup
+{
+public:
+	DescriptorPoolGroup() = default;
+
+	DescriptorPoolGroup(const DescriptorPoolGroup&) = delete;
+	DescriptorPoolGroup& operator=(const DescriptorPoolGroup&) = delete;
+
+	void init(VkDevice device);
+
+	void destroy();
+
+	/**
+	 * \brief 分配一个描述符集，当前的池用完时换下一个池，没有时创建一个更大的池
+	 * \param layout
+	 * \return
+	 */
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+	/**
+	 * \brief 用vkResetDescriptorPool回收所有池中的描述符集，池本身留给之后的分配
+	 */
+	void reset();
+
+	size_t getPoolCount() const
+	{
+		return m_pools.size();
+	}
+
+	uint64_t getAllocatedSetCount() const
+	{
+		return m_allocatedSets;
+	}
+
+private:
+	VkDevice m_device = VK_NULL_HANDLE;
+
+	std::vector<VkDescriptorPool> m_pools;
+
+	// 正在分配的池在m_pools中的索引，它之前的池已经用完
+	size_t m_currentPool = 0;
+
+	// 下一个新建的池能容纳的描述符集数
+	uint32_t m_nextPoolSets = 0;
+
+	uint64_t m_allocatedSets = 0;
+
+	/**
+	 * \brief 创建一个新的池并加到末尾
+	 */
+	void createPool();
+};
+
+/**
+ * \brief 描述符集分配器
+ *
+ * 每帧录制的临时描述符集从这一帧自己的池中分配，帧的栅栏触发后用vkResetDescriptorPool一次回收，
+ * 不逐个释放描述符集。内容不变的长期描述符集按布局和内容缓存，相同的内容只分配和写入一次。
+ * 所有函数都可以在多个录制线程上同时调用。
+ */
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator() = default;
+
+	DescriptorAllocator(const DescriptorAllocator&) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+	/**
+	 * \brief 初始化
+	 * \param device
+	 * \param frameCount 飞行中的帧数
+	 */
+	void init(VkDevice device, uint32_t frameCount);
+
+	/**
+	 * \brief 销毁所有描述符池，调用前设备应该已经空闲
+	 */
+	void destroy();
+
+	/**
+	 * \brief 开始一帧，回收这一帧上一次分配的所有临时描述符集
+	 * \param frameIndex 调用前这一帧的栅栏必须已经触发
+	 */
+	void beginFrame(uint32_t frameIndex);
+
+	/**
+	 * \brief 分配一个只在当前帧使用的描述符集
+	 * \param layout
+	 * \return
+	 */
+	VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout);
+
+	/**
+	 * \brief 分配并写入一个只在当前帧使用的描述符集
+	 * \param layout
+	 * \param contents
+	 * \return
+	 */
+	VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout, const DescriptorSetContents& contents);
+
+	/**
+	 * \brief 取得一个内容固定的长期描述符集，布局和内容相同时返回同一个
+	 * \param layout
+	 * \param contents 引用的资源销毁之前必须先调用resetCache
+	 * \return
+	 */
+	VkDescriptorSet getCached(VkDescriptorSetLayout layout, const DescriptorSetContents& contents);
+
+	/**
+	 * \brief 丢弃所有长期描述符集，调用前不能再有使用它们的帧在飞行中
+	 */
+	void resetCache();
+
+	size_t getPoolCount() const;
+
+	/**
+	 * \brief 所有帧累计分配的临时描述符集数
+	 * \return
+	 */
+	uint64_t getTransientSetCount() const;
+
+	size_t getCachedSetCount() const;
+
+	uint64_t getCacheHitCount() const;
+
+private:
+	/**
+	 * \brief 长期描述符集缓存的键
+	 */
+	struct CacheKey
+	{
+		VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+		DescriptorSetContents m_contents;
+
+		bool operator==(const CacheKey& other) const
+		{
+			return m_layout == other.m_layout && m_contents == other.m_contents;
+		}
+	};
+
+	struct CacheKeyHash
+	{
+		size_t operator()(const CacheKey& key) const;
+	};
+
+	VkDevice m_device = VK_NULL_HANDLE;
+
+	// 保护下面所有成员
+	mutable std::mutex m_mutex;
+
+	// 每个飞行中的帧的临时描述符池
+	std::vector<std::unique_ptr<DescriptorPoolGroup>> m_framePools;
+
+	// 当前录制的帧
+	uint32_t m_currentFrame = 0;
+
+	// 长期描述符集的池和缓存
+	DescriptorPoolGroup m_cachePools;
+	std::unordered_map<CacheKey, VkDescriptorSet, CacheKeyHash> m_cache;
+
+	uint64_t m_cacheHits = 0;
+};
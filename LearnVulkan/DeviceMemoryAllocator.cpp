@@ -0,0 +1,614 @@
+#include "DeviceMemoryAllocator.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace
+{
+	// 伙伴算法的最小节点，所有子分配都至少按它对齐
+	const VkDeviceSize MIN_NODE_SIZE = 256;
+
+	// 大块的最小尺寸，小内存堆也不会再缩小
+	const VkDeviceSize MIN_BLOCK_SIZE = 1ull << 20;
+
+	/**
+	 * \brief 不小于value的最小的2的幂
+	 * \param value
+	 * \return
+	 */
+	VkDeviceSize nextPowerOfTwo(VkDeviceSize value)
+	{
+		VkDeviceSize result = 1;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+
+	/**
+	 * \brief 不大于value的最大的2的幂
+	 * \param value
+	 * \return
+	 */
+	VkDeviceSize previousPowerOfTwo(VkDeviceSize value)
+	{
+		VkDeviceSize result = 1;
+		while (result <= value / 2)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+
+	/**
+	 * \brief 以2为底的对数，value必须是2的幂
+	 * \param value
+	 * \return
+	 */
+	uint32_t log2(VkDeviceSize value)
+	{
+		uint32_t result = 0;
+		while (value > 1)
+		{
+			value >>= 1;
+			result++;
+		}
+		return result;
+	}
+}
+
+/**
+ * \brief 一块设备内存，内部用伙伴算法管理
+ */
+class DeviceMemoryAllocator::BuddyBlock
+{
+public:
+	BuddyBlock(VkDeviceMemory memory, void* mapped, VkDeviceSize size)
+		: m_memory(memory), m_mapped(mapped), m_size(size), m_maxOrder(log2(size / MIN_NODE_SIZE))
+	{
+		m_freeLists.resize(m_maxOrder + 1);
+		m_freeLists[m_maxOrder].insert(0);
+	}
+
+	/**
+	 * \brief 分配一个指定阶的节点
+	 * \param order 节点大小为MIN_NODE_SIZE << order
+	 * \param size 资源实际请求的字节数，只用于统计
+	 * \param offset 返回节点在大块中的偏移
+	 * \return 大块中没有足够空间时返回false
+	 */
+	bool allocate(uint32_t order, VkDeviceSize size, VkDeviceSize& offset)
+	{
+		if (order > m_maxOrder)
+		{
+			return false;
+		}
+
+		// 找到不小于所需阶的最小空闲节点
+		uint32_t current = order;
+		while (current <= m_maxOrder && m_freeLists[current].empty())
+		{
+			current++;
+		}
+
+		if (current > m_maxOrder)
+		{
+			return false;
+		}
+
+		offset = *m_freeLists[current].begin();
+		m_freeLists[current].erase(m_freeLists[current].begin());
+
+		// 逐级对半拆分，后一半放回空闲链表
+		while (current > order)
+		{
+			current--;
+			m_freeLists[current].insert(offset + nodeSize(current));
+		}
+
+		m_allocatedBytes += nodeSize(order);
+		m_usedBytes += size;
+		m_allocationCount++;
+		return true;
+	}
+
+	/**
+	 * \brief 释放节点，并与空闲的伙伴逐级合并
+	 * \param offset
+	 * \param order
+	 * \param size
+	 */
+	void free(VkDeviceSize offset, uint32_t order, VkDeviceSize size)
+	{
+		m_allocatedBytes -= nodeSize(order);
+		m_usedBytes -= size;
+		m_allocationCount--;
+
+		while (order < m_maxOrder)
+		{
+			VkDeviceSize buddy = offset ^ nodeSize(order);
+			auto it = m_freeLists[order].find(buddy);
+			if (it == m_freeLists[order].end())
+			{
+				break;
+			}
+
+			m_freeLists[order].erase(it);
+			offset = std::min(offset, buddy);
+			order++;
+		}
+
+		m_freeLists[order].insert(offset);
+	}
+
+	/**
+	 * \brief 最大的空闲节点
+	 * \return
+	 */
+	VkDeviceSize largestFreeRange() const
+	{
+		for (uint32_t order = m_maxOrder + 1; order-- > 0;)
+		{
+			if (!m_freeLists[order].empty())
+			{
+				return nodeSize(order);
+			}
+		}
+		return 0;
+	}
+
+	static VkDeviceSize nodeSize(uint32_t order)
+	{
+		return MIN_NODE_SIZE << order;
+	}
+
+	VkDeviceMemory m_memory;
+	void* m_mapped;
+	VkDeviceSize m_size;
+	uint32_t m_maxOrder;
+
+	// 每一阶的空闲节点偏移
+	std::vector<std::set<VkDeviceSize>> m_freeLists;
+
+	VkDeviceSize m_allocatedBytes = 0;
+	VkDeviceSize m_usedBytes = 0;
+	uint32_t m_allocationCount = 0;
+};
+
+DeviceMemoryAllocator::DeviceMemoryAllocator()
+{
+}
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+	destroy();
+}
+
+void DeviceMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize)
+{
+	m_physicalDevice = physicalDevice;
+	m_device = device;
+	m_preferredBlockSize = previousPowerOfTwo(std::max(preferredBlockSize, MIN_BLOCK_SIZE));
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+	m_maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+	m_supportsDedicatedQuery = properties.apiVersion >= VK_API_VERSION_1_1;
+}
+
+void DeviceMemoryAllocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (auto& pool : m_pools)
+	{
+		for (auto& block : pool.m_blocks)
+		{
+			if (block)
+			{
+				freeDeviceMemory(block->m_memory);
+			}
+		}
+	}
+
+	for (auto& dedicated : m_dedicatedAllocations)
+	{
+		freeDeviceMemory(dedicated.m_memory);
+	}
+
+	m_pools.clear();
+	m_dedicatedAllocations.clear();
+	m_device = VK_NULL_HANDLE;
+}
+
+MemoryAllocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind,
+	bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+	VkDeviceSize blockSize = getBlockSize(memoryType);
+
+	VkDeviceSize nodeSize = nextPowerOfTwo(std::max(std::max(requirements.size, requirements.alignment), MIN_NODE_SIZE));
+
+	// 超过半个大块的资源单独分配，避免大块被一个资源占满
+	if (dedicated || nodeSize > blockSize / 2)
+	{
+		return allocateDedicated(requirements.size, memoryType, dedicatedBuffer, dedicatedImage);
+	}
+
+	// 节点按自身大小对齐，粒度不超过最小节点时不同资源不会落在同一粒度页上，不需要按排布分开
+	if (m_bufferImageGranularity <= MIN_NODE_SIZE)
+	{
+		kind = ResourceKind::Linear;
+	}
+
+	uint32_t poolIndex = getPoolIndex(memoryType, kind);
+	Pool& pool = m_pools[poolIndex];
+
+	uint32_t order = log2(nodeSize / MIN_NODE_SIZE);
+
+	MemoryAllocation allocation;
+	allocation.m_size = requirements.size;
+	allocation.m_memoryType = memoryType;
+	allocation.m_poolIndex = poolIndex;
+	allocation.m_order = order;
+
+	uint32_t freeSlot = UINT32_MAX;
+	for (uint32_t i = 0; i < pool.m_blocks.size(); i++)
+	{
+		BuddyBlock* block = pool.m_blocks[i].get();
+		if (!block)
+		{
+			freeSlot = std::min(freeSlot, i);
+			continue;
+		}
+
+		if (block->allocate(order, requirements.size, allocation.m_offset))
+		{
+			allocation.m_blockIndex = i;
+			break;
+		}
+	}
+
+	// 现有大块都放不下，申请新的大块
+	if (allocation.m_blockIndex == UINT32_MAX)
+	{
+		VkDeviceMemory memory = allocateDeviceMemory(pool.m_blockSize, memoryType, nullptr);
+		std::unique_ptr<BuddyBlock> block(new BuddyBlock(memory, mapIfHostVisible(memory, memoryType), pool.m_blockSize));
+		block->allocate(order, requirements.size, allocation.m_offset);
+
+		if (freeSlot == UINT32_MAX)
+		{
+			freeSlot = static_cast<uint32_t>(pool.m_blocks.size());
+			pool.m_blocks.emplace_back();
+		}
+		pool.m_blocks[freeSlot] = std::move(block);
+		allocation.m_blockIndex = freeSlot;
+	}
+
+	BuddyBlock* block = pool.m_blocks[allocation.m_blockIndex].get();
+	allocation.m_memory = block->m_memory;
+	if (block->m_mapped != nullptr)
+	{
+		allocation.m_mapped = static_cast<char*>(block->m_mapped) + allocation.m_offset;
+	}
+
+	return allocation;
+}
+
+MemoryAllocation DeviceMemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+	VkMemoryRequirements requirements;
+	bool dedicated = false;
+
+	if (m_supportsDedicatedQuery)
+	{
+		VkMemoryDedicatedRequirements dedicatedRequirements = {};
+		dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 requirements2 = {};
+		requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements2.pNext = &dedicatedRequirements;
+
+		VkBufferMemoryRequirementsInfo2 info = {};
+		info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+		info.buffer = buffer;
+
+		vkGetBufferMemoryRequirements2(m_device, &info, &requirements2);
+		requirements = requirements2.memoryRequirements;
+		dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+	}
+	else
+	{
+		vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+	}
+
+	MemoryAllocation allocation = allocate(requirements, properties, ResourceKind::Linear, dedicated, buffer, VK_NULL_HANDLE);
+	if (vkBindBufferMemory(m_device, buffer, allocation.m_memory, allocation.m_offset) != VK_SUCCESS)
+	{
+		free(allocation);
+		throw std::runtime_error("failed to bind buffer memory!");
+	}
+
+	return allocation;
+}
+
+MemoryAllocation DeviceMemoryAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling)
+{
+	VkMemoryRequirements requirements;
+	bool dedicated = false;
+
+	if (m_supportsDedicatedQuery)
+	{
+		VkMemoryDedicatedRequirements dedicatedRequirements = {};
+		dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 requirements2 = {};
+		requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements2.pNext = &dedicatedRequirements;
+
+		VkImageMemoryRequirementsInfo2 info = {};
+		info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+		info.image = image;
+
+		vkGetImageMemoryRequirements2(m_device, &info, &requirements2);
+		requirements = requirements2.memoryRequirements;
+		dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+	}
+	else
+	{
+		vkGetImageMemoryRequirements(m_device, image, &requirements);
+	}
+
+	ResourceKind kind = tiling == VK_IMAGE_TILING_LINEAR ? ResourceKind::Linear : ResourceKind::Optimal;
+	MemoryAllocation allocation = allocate(requirements, properties, kind, dedicated, VK_NULL_HANDLE, image);
+	if (vkBindImageMemory(m_device, image, allocation.m_memory, allocation.m_offset) != VK_SUCCESS)
+	{
+		free(allocation);
+		throw std::runtime_error("failed to bind image memory!");
+	}
+
+	return allocation;
+}
+
+void DeviceMemoryAllocator::free(MemoryAllocation& allocation)
+{
+	if (!allocation.isValid())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (allocation.isDedicated())
+	{
+		auto it = std::find_if(m_dedicatedAllocations.begin(), m_dedicatedAllocations.end(),
+			[&](const DedicatedAllocation& dedicated) { return dedicated.m_memory == allocation.m_memory; });
+		if (it != m_dedicatedAllocations.end())
+		{
+			freeDeviceMemory(it->m_memory);
+			m_dedicatedAllocations.erase(it);
+		}
+	}
+	else
+	{
+		Pool& pool = m_pools[allocation.m_poolIndex];
+		BuddyBlock* block = pool.m_blocks[allocation.m_blockIndex].get();
+		block->free(allocation.m_offset, allocation.m_order, allocation.m_size);
+
+		// 保留一个空的大块，避免分配和释放交替时反复向驱动申请
+		if (block->m_allocationCount == 0)
+		{
+			bool hasOtherEmptyBlock = false;
+			for (uint32_t i = 0; i < pool.m_blocks.size(); i++)
+			{
+				if (i != allocation.m_blockIndex && pool.m_blocks[i] && pool.m_blocks[i]->m_allocationCount == 0)
+				{
+					hasOtherEmptyBlock = true;
+					break;
+				}
+			}
+
+			if (hasOtherEmptyBlock)
+			{
+				freeDeviceMemory(block->m_memory);
+				pool.m_blocks[allocation.m_blockIndex].reset();
+			}
+		}
+	}
+
+	allocation = MemoryAllocation();
+}
+
+uint32_t DeviceMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+std::vector<HeapStatistics> DeviceMemoryAllocator::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::map<uint32_t, HeapStatistics> heaps;
+	auto heapFor = [&](uint32_t memoryType) -> HeapStatistics&
+	{
+		uint32_t heapIndex = m_memoryProperties.memoryTypes[memoryType].heapIndex;
+		HeapStatistics& stats = heaps[heapIndex];
+		stats.m_heapIndex = heapIndex;
+		stats.m_heapSize = m_memoryProperties.memoryHeaps[heapIndex].size;
+		return stats;
+	};
+
+	for (const auto& pool : m_pools)
+	{
+		for (const auto& block : pool.m_blocks)
+		{
+			if (!block)
+			{
+				continue;
+			}
+
+			HeapStatistics& stats = heapFor(pool.m_memoryType);
+			stats.m_blockCount++;
+			stats.m_allocationCount += block->m_allocationCount;
+			stats.m_bytesReserved += block->m_size;
+			stats.m_bytesAllocated += block->m_allocatedBytes;
+			stats.m_bytesUsed += block->m_usedBytes;
+			VkDeviceSize largestFreeRange = block->largestFreeRange();
+			stats.m_largestFreeRange = std::max(stats.m_largestFreeRange, largestFreeRange);
+			// 碎片按块计算，多个空块不应被算作碎片
+			stats.m_fragmentedFreeBytes += block->m_size - block->m_allocatedBytes - largestFreeRange;
+		}
+	}
+
+	for (const auto& dedicated : m_dedicatedAllocations)
+	{
+		HeapStatistics& stats = heapFor(dedicated.m_memoryType);
+		stats.m_dedicatedCount++;
+		stats.m_bytesReserved += dedicated.m_size;
+		stats.m_bytesAllocated += dedicated.m_size;
+		stats.m_bytesUsed += dedicated.m_size;
+	}
+
+	std::vector<HeapStatistics> result;
+	for (const auto& heap : heaps)
+	{
+		result.push_back(heap.second);
+	}
+	return result;
+}
+
+void DeviceMemoryAllocator::printStatistics(std::ostream& out) const
+{
+	for (const auto& stats : getStatistics())
+	{
+		out << "heap " << stats.m_heapIndex << ": "
+			<< (stats.m_bytesUsed >> 10) << " KiB used, "
+			<< (stats.m_bytesAllocated >> 10) << " KiB allocated, "
+			<< (stats.m_bytesReserved >> 10) << " KiB reserved of " << (stats.m_heapSize >> 20) << " MiB, "
+			<< stats.m_allocationCount << " sub-allocations in " << stats.m_blockCount << " blocks, "
+			<< stats.m_dedicatedCount << " dedicated, "
+			<< "fragmentation " << stats.fragmentation() * 100.0 << "%" << std::endl;
+	}
+	out << "vkAllocateMemory calls: " << m_deviceAllocationCount << std::endl;
+}
+
+uint32_t DeviceMemoryAllocator::getPoolIndex(uint32_t memoryType, ResourceKind kind)
+{
+	for (uint32_t i = 0; i < m_pools.size(); i++)
+	{
+		if (m_pools[i].m_memoryType == memoryType && m_pools[i].m_kind == kind)
+		{
+			return i;
+		}
+	}
+
+	Pool pool;
+	pool.m_memoryType = memoryType;
+	pool.m_kind = kind;
+	pool.m_blockSize = getBlockSize(memoryType);
+	m_pools.push_back(std::move(pool));
+	return static_cast<uint32_t>(m_pools.size() - 1);
+}
+
+VkDeviceSize DeviceMemoryAllocator::getBlockSize(uint32_t memoryType) const
+{
+	// 大块不超过内存堆的八分之一，小的内存堆（例如可映射的显存窗口）不会被一个大块占满
+	VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+	VkDeviceSize blockSize = m_preferredBlockSize;
+	while (blockSize > MIN_BLOCK_SIZE && blockSize > heapSize / 8)
+	{
+		blockSize >>= 1;
+	}
+	return blockSize;
+}
+
+VkDeviceMemory DeviceMemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext)
+{
+	if (m_maxMemoryAllocationCount != 0 && m_liveDeviceAllocations >= m_maxMemoryAllocationCount)
+	{
+		throw std::runtime_error("exceeded maxMemoryAllocationCount!");
+	}
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = pNext;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate device memory!");
+	}
+
+	m_liveDeviceAllocations++;
+	m_deviceAllocationCount++;
+	return memory;
+}
+
+void DeviceMemoryAllocator::freeDeviceMemory(VkDeviceMemory memory)
+{
+	// 释放内存会隐式解除映射
+	vkFreeMemory(m_device, memory, nullptr);
+	m_liveDeviceAllocations--;
+}
+
+void* DeviceMemoryAllocator::mapIfHostVisible(VkDeviceMemory memory, uint32_t memoryType)
+{
+	if (!(m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+	{
+		return nullptr;
+	}
+
+	void* mapped = nullptr;
+	if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to map device memory!");
+	}
+	return mapped;
+}
+
+MemoryAllocation DeviceMemoryAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryType, VkBuffer buffer, VkImage image)
+{
+	// 告诉驱动这块内存只给一个资源使用，驱动可以借此选择更好的排布
+	VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.buffer = buffer;
+	dedicatedInfo.image = image;
+
+	bool useDedicatedInfo = m_supportsDedicatedQuery && (buffer != VK_NULL_HANDLE || image != VK_NULL_HANDLE);
+
+	DedicatedAllocation dedicated;
+	dedicated.m_memory = allocateDeviceMemory(size, memoryType, useDedicatedInfo ? &dedicatedInfo : nullptr);
+	dedicated.m_memoryType = memoryType;
+	dedicated.m_size = size;
+	m_dedicatedAllocations.push_back(dedicated);
+
+	MemoryAllocation allocation;
+	allocation.m_memory = dedicated.m_memory;
+	allocation.m_offset = 0;
+	allocation.m_size = size;
+	allocation.m_memoryType = memoryType;
+	allocation.m_mapped = mapIfHostVisible(dedicated.m_memory, memoryType);
+	return allocation;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <vector>
+
+/**
+ * \brief 资源的内存排布，线性资源（缓冲、线性图像）与最优排布图像相邻时需要遵守bufferImageGranularity
+ */
+enum class ResourceKind
+{
+	Linear,
+	Optimal,
+};
+
+/**
+ * \brief 一次内存分配的结果
+ */
+struct MemoryAllocation
+{
+	// 所在的设备内存对象
+	VkDeviceMemory m_memory = VK_NULL_HANDLE;
+
+	// 在设备内存对象中的偏移
+	VkDeviceSize m_offset = 0;
+
+	// 请求的字节数
+	VkDeviceSize m_size = 0;
+
+	// 持久映射的地址，已经加上偏移，不可映射的内存为空
+	void* m_mapped = nullptr;
+
+	// 内存类型索引
+	uint32_t m_memoryType = 0;
+
+	// 以下供分配器内部使用
+	uint32_t m_poolIndex = UINT32_MAX;
+	uint32_t m_blockIndex = UINT32_MAX;
+	uint32_t m_order = 0;
+
+	bool isValid() const
+	{
+		return m_memory != VK_NULL_HANDLE;
+	}
+
+	bool isDedicated() const
+	{
+		return m_blockIndex == UINT32_MAX;
+	}
+};
+
+/**
+ * \brief 每个内存堆的统计信息
+ */
+struct HeapStatistics
+{
+	// 内存堆索引
+	uint32_t m_heapIndex = 0;
+
+	// 内存堆的总大小
+	VkDeviceSize m_heapSize = 0;
+
+	// 大块的数量
+	uint32_t m_blockCount = 0;
+
+	// 独占分配的数量
+	uint32_t m_dedicatedCount = 0;
+
+	// 子分配的数量
+	uint32_t m_allocationCount = 0;
+
+	// 向驱动申请的总字节数，包括大块和独占分配
+	VkDeviceSize m_bytesReserved = 0;
+
+	// 资源实际请求的字节数
+	VkDeviceSize m_bytesUsed = 0;
+
+	// 伙伴节点占用的字节数，与m_bytesUsed的差值为取整造成的内部碎片
+	VkDeviceSize m_bytesAllocated = 0;
+
+	// 大块中最大的连续空闲区间
+	VkDeviceSize m_largestFreeRange = 0;
+
+	// 各大块中不属于该块最大空闲区间的空闲字节之和
+	VkDeviceSize m_fragmentedFreeBytes = 0;
+
+	/**
+	 * \brief 外部碎片率，按空闲字节加权的各大块碎片率，0表示每个大块内的空闲空间都是连续的
+	 * \return
+	 */
+	double fragmentation() const
+	{
+		VkDeviceSize freeBytes = m_bytesReserved - m_bytesAllocated;
+		if (freeBytes == 0 || m_blockCount == 0)
+		{
+			return 0.0;
+		}
+		return static_cast<double>(m_fragmentedFreeBytes) / static_cast<double>(freeBytes);
+	}
+};
+
+/**
+ * \brief 设备内存子分配器
+ *
+ * 每种内存类型按需申请大块内存，大块内部用伙伴算法放置资源，避免每个资源都调用一次vkAllocateMemory。
+ * 大资源和驱动要求独占的资源单独分配。可映射的大块在创建时持久映射。
+ */
+class DeviceMemoryAllocator
+{
+public:
+	DeviceMemoryAllocator();
+	~DeviceMemoryAllocator();
+
+	DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+	DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+	/**
+	 * \brief 初始化
+	 * \param physicalDevice
+	 * \param device
+	 * \param preferredBlockSize 大块的大小，小内存堆会自动缩小
+	 */
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = 64ull << 20);
+
+	/**
+	 * \brief 释放所有内存，调用前所有分配都应该已经释放
+	 */
+	void destroy();
+
+	/**
+	 * \brief 按内存需求分配内存
+	 * \param requirements
+	 * \param properties 需要的内存属性
+	 * \param kind 资源的内存排布
+	 * \param dedicated 是否强制独占分配
+	 * \param dedicatedBuffer 独占分配时绑定的缓冲，可以为空
+	 * \param dedicatedImage 独占分配时绑定的图像，可以为空
+	 * \return
+	 */
+	MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind,
+		bool dedicated = false, VkBuffer dedicatedBuffer = VK_NULL_HANDLE, VkImage dedicatedImage = VK_NULL_HANDLE);
+
+	/**
+	 * \brief 为缓冲分配内存并绑定
+	 * \param buffer
+	 * \param properties
+	 * \return
+	 */
+	MemoryAllocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+
+	/**
+	 * \brief 为图像分配内存并绑定，驱动建议时使用独占分配
+	 * \param image
+	 * \param properties
+	 * \param tiling 图像的排布方式
+	 * \return
+	 */
+	MemoryAllocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+
+	/**
+	 * \brief 释放分配，之后allocation被重置为无效
+	 * \param allocation
+	 */
+	void free(MemoryAllocation& allocation);
+
+	/**
+	 * \brief 寻找满足需求的内存类型
+	 * \param typeFilter 可用内存类型的位域
+	 * \param properties 需要的内存属性
+	 * \return
+	 */
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	/**
+	 * \brief 按内存堆汇总的统计信息，只包含有分配的堆
+	 * \return
+	 */
+	std::vector<HeapStatistics> getStatistics() const;
+
+	/**
+	 * \brief 打印统计信息
+	 * \param out
+	 */
+	void printStatistics(std::ostream& out) const;
+
+	/**
+	 * \brief 调用vkAllocateMemory的总次数
+	 * \return
+	 */
+	uint64_t getDeviceAllocationCount() const
+	{
+		return m_deviceAllocationCount;
+	}
+
+private:
+	class BuddyBlock;
+
+	/**
+	 * \brief 同一内存类型、同一排布的大块集合
+	 */
+	struct Pool
+	{
+		uint32_t m_memoryType = 0;
+		ResourceKind m_kind = ResourceKind::Linear;
+		VkDeviceSize m_blockSize = 0;
+		std::vector<std::unique_ptr<BuddyBlock>> m_blocks;
+	};
+
+	/**
+	 * \brief 独占分配的记录
+	 */
+	struct DedicatedAllocation
+	{
+		VkDeviceMemory m_memory = VK_NULL_HANDLE;
+		uint32_t m_memoryType = 0;
+		VkDeviceSize m_size = 0;
+	};
+
+	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+	VkDevice m_device = VK_NULL_HANDLE;
+
+	VkPhysicalDeviceMemoryProperties m_memoryProperties = {};
+
+	// 线性资源与最优排布图像之间需要的间隔
+	VkDeviceSize m_bufferImageGranularity = 1;
+
+	// 驱动允许的vkAllocateMemory上限
+	uint32_t m_maxMemoryAllocationCount = 0;
+
+	// 设备是否支持Vulkan 1.1，支持时查询驱动对独占分配的建议
+	bool m_supportsDedicatedQuery = false;
+
+	VkDeviceSize m_preferredBlockSize = 0;
+
+	std::vector<Pool> m_pools;
+	std::vector<DedicatedAllocation> m_dedicatedAllocations;
+
+	// 当前存活的设备内存对象数量
+	uint32_t m_liveDeviceAllocations = 0;
+
+	// 累计的vkAllocateMemory次数
+	uint64_t m_deviceAllocationCount = 0;
+
+	mutable std::mutex m_mutex;
+
+	uint32_t getPoolIndex(uint32_t memoryType, ResourceKind kind);
+	VkDeviceSize getBlockSize(uint32_t memoryType) const;
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext);
+	void freeDeviceMemory(VkDeviceMemory memory);
+	void* mapIfHostVisible(VkDeviceMemory memory, uint32_t memoryType);
+	MemoryAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryType, VkBuffer buffer, VkImage image);
+};
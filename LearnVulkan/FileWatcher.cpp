@@ -0,0 +1,165 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// 没有inotify时两次比较修改时间的最短间隔
+	const std::chrono::milliseconds SCAN_INTERVAL(100);
+
+	/**
+	 * \brief 读取文件的修改时间和大小
+	 * \param path
+	 * \param modifiedTime 文件不存在时为-1
+	 * \param size 文件不存在时为-1
+	 */
+	void getFileStatus(const std::string& path, int64_t& modifiedTime, int64_t& size)
+	{
+#ifdef _WIN32
+		struct _stat64 info;
+		bool exists = _stat64(path.c_str(), &info) == 0;
+#else
+		struct stat info;
+		bool exists = stat(path.c_str(), &info) == 0;
+#endif
+		modifiedTime = exists ? static_cast<int64_t>(info.st_mtime) : -1;
+		size = exists ? static_cast<int64_t>(info.st_size) : -1;
+	}
+
+	/**
+	 * \brief 把路径拆成目录和文件名
+	 * \param path
+	 * \param directory 没有目录部分时为当前目录
+	 * \param name
+	 */
+	void splitPath(const std::string& path, std::string& directory, std::string& name)
+	{
+		size_t separator = path.find_last_of("/\\");
+		if (separator == std::string::npos)
+		{
+			directory = ".";
+			name = path;
+		}
+		else
+		{
+			directory = separator == 0 ? path.substr(0, 1) : path.substr(0, separator);
+			name = path.substr(separator + 1);
+		}
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	destroy();
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+	WatchedFile file;
+	file.m_path = path;
+
+	std::string directory;
+	splitPath(path, directory, file.m_name);
+
+#ifdef __linux__
+	if (m_inotify == -1)
+	{
+		m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	}
+	if (m_inotify != -1)
+	{
+		// 同一个目录重复添加时返回已有的描述符
+		file.m_watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (file.m_watch == -1)
+		{
+			throw std::runtime_error("failed to watch directory " + directory + "!");
+		}
+	}
+#endif
+
+	getFileStatus(path, file.m_modifiedTime, file.m_size);
+	m_files.push_back(file);
+}
+
+void FileWatcher::destroy()
+{
+#ifdef __linux__
+	if (m_inotify != -1)
+	{
+		close(m_inotify);
+	}
+#endif
+	m_inotify = -1;
+	m_files.clear();
+}
+
+std::vector<std::string> FileWatcher::poll()
+{
+	std::vector<std::string> changed;
+
+#ifdef __linux__
+	if (m_inotify != -1)
+	{
+		alignas(inotify_event) char buffer[4096];
+		for (;;)
+		{
+			ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+			if (length <= 0)
+			{
+				break;
+			}
+
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+				if (event->len == 0)
+				{
+					continue;
+				}
+
+				for (const WatchedFile& file : m_files)
+				{
+					if (file.m_watch == event->wd && file.m_name == event->name &&
+						std::find(changed.begin(), changed.end(), file.m_path) == changed.end())
+					{
+						changed.push_back(file.m_path);
+					}
+				}
+			}
+		}
+		return changed;
+	}
+#endif
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_lastScan < SCAN_INTERVAL)
+	{
+		return changed;
+	}
+	m_lastScan = now;
+
+	for (WatchedFile& file : m_files)
+	{
+		int64_t modifiedTime = 0;
+		int64_t size = 0;
+		getFileStatus(file.m_path, modifiedTime, size);
+
+		// 文件被删除时不算修改，等它重新出现
+		if (modifiedTime != -1 && (modifiedTime != file.m_modifiedTime || size != file.m_size))
+		{
+			changed.push_back(file.m_path);
+		}
+		file.m_modifiedTime = modifiedTime;
+		file.m_size = size;
+	}
+	return changed;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief 监视一组文件的修改，由主线程每帧非阻塞地查询
+ *
+ * Linux上用inotify监视文件所在的目录，编辑器先写临时文件再改名覆盖的保存方式也能收到通知；
+ * 其他平台定期比较文件的修改时间和大小。
+ */
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	/**
+	 * \brief 开始监视一个文件，文件可以暂时不存在，但所在的目录必须存在
+	 * \param path
+	 */
+	void watch(const std::string& path);
+
+	/**
+	 * \brief 停止监视所有文件
+	 */
+	void destroy();
+
+	/**
+	 * \brief 取出上次调用以来被修改过的文件，每个文件只出现一次
+	 * \return 传给watch的路径
+	 */
+	std::vector<std::string> poll();
+
+	bool empty() const
+	{
+		return m_files.empty();
+	}
+
+private:
+	struct WatchedFile
+	{
+		std::string m_path;
+
+		// 所在目录中的文件名
+		std::string m_name;
+
+		// 所在目录的inotify监视描述符
+		int m_watch = -1;
+
+		// 上次检查时的修改时间和大小，不存在时为-1
+		int64_t m_modifiedTime = -1;
+		int64_t m_size = -1;
+	};
+
+	std::vector<WatchedFile> m_files;
+
+	// inotify实例，不使用inotify时为-1
+	int m_inotify = -1;
+
+	// 比较修改时间的最短间隔
+	std::chrono::steady_clock::time_point m_lastScan;
+};
@@ -0,0 +1,267 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "Json.h"
+
+namespace
+{
+	// 每个作用域保留的样本数
+	const size_t SAMPLE_WINDOW = 512;
+
+	// 未使用的查询索引，endScope遇到时不写时间戳
+	const uint32_t INVALID_QUERY = UINT32_MAX;
+}
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount, uint32_t maxScopes)
+{
+	m_device = device;
+	m_maxScopes = maxScopes;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	// timestampValidBits为0表示该队列族不支持时间戳
+	uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+	m_enabled = validBits > 0;
+	if (!m_enabled)
+	{
+		return;
+	}
+	m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	m_frames.resize(frameCount);
+	for (auto& frame : m_frames)
+	{
+		VkQueryPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = maxScopes * 2;
+
+		if (vkCreateQueryPool(m_device, &poolInfo, nullptr, &frame.m_pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create timestamp query pool!");
+		}
+		frame.m_scopeNames.reserve(maxScopes);
+	}
+}
+
+void GpuProfiler::destroy()
+{
+	for (auto& frame : m_frames)
+	{
+		vkDestroyQueryPool(m_device, frame.m_pool, nullptr);
+	}
+	m_frames.clear();
+	m_enabled = false;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	m_currentFrame = frameIndex;
+	FrameQueries& frame = m_frames[frameIndex];
+
+	// 这一槽位上一次提交的帧已经完成，读取结果不会等待
+	readResults(frame);
+
+	vkCmdResetQueryPool(commandBuffer, frame.m_pool, 0, m_maxScopes * 2);
+	frame.m_scopeNames.clear();
+	frame.m_pending = true;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!m_enabled)
+	{
+		return INVALID_QUERY;
+	}
+
+	FrameQueries& frame = m_frames[m_currentFrame];
+	if (frame.m_scopeNames.size() >= m_maxScopes)
+	{
+		return INVALID_QUERY;
+	}
+
+	uint32_t query = static_cast<uint32_t>(frame.m_scopeNames.size()) * 2;
+	frame.m_scopeNames.push_back(name);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.m_pool, query);
+	return query;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t query)
+{
+	if (query == INVALID_QUERY)
+	{
+		return;
+	}
+
+	// 之前的命令全部执行完后才写入
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[m_currentFrame].m_pool, query + 1);
+}
+
+void GpuProfiler::collectAll()
+{
+	for (auto& frame : m_frames)
+	{
+		readResults(frame);
+	}
+}
+
+void GpuProfiler::readResults(FrameQueries& frame)
+{
+	if (!frame.m_pending || frame.m_scopeNames.empty())
+	{
+		frame.m_pending = false;
+		return;
+	}
+	frame.m_pending = false;
+
+	uint32_t queryCount = static_cast<uint32_t>(frame.m_scopeNames.size()) * 2;
+	std::vector<uint64_t> timestamps(queryCount);
+
+	// 不带WAIT标志，结果还不可用时放弃这一帧而不是阻塞
+	VkResult result = vkGetQueryPoolResults(m_device, frame.m_pool, 0, queryCount, timestamps.size() * sizeof(uint64_t),
+		timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < frame.m_scopeNames.size(); i++)
+	{
+		uint64_t begin = timestamps[i * 2] & m_timestampMask;
+		uint64_t end = timestamps[i * 2 + 1] & m_timestampMask;
+		uint64_t ticks = (end - begin) & m_timestampMask;
+		addSample(frame.m_scopeNames[i], ticks * m_timestampPeriod * 1e-6);
+	}
+}
+
+void GpuProfiler::addSample(const char* name, double milliseconds)
+{
+	ScopeSamples& scope = m_scopes[name];
+	if (scope.m_samples.size() < SAMPLE_WINDOW)
+	{
+		scope.m_samples.push_back(milliseconds);
+	}
+	else
+	{
+		scope.m_samples[scope.m_next] = milliseconds;
+	}
+	scope.m_next = (scope.m_next + 1) % SAMPLE_WINDOW;
+	scope.m_count++;
+}
+
+std::vector<GpuScopeStatistics> GpuProfiler::getStatistics() const
+{
+	std::vector<GpuScopeStatistics> result;
+	for (const auto& entry : m_scopes)
+	{
+		const ScopeSamples& scope = entry.second;
+		if (scope.m_samples.empty())
+		{
+			continue;
+		}
+
+		std::vector<double> sorted = scope.m_samples;
+		std::sort(sorted.begin(), sorted.end());
+
+		double sum = 0.0;
+		for (double sample : sorted)
+		{
+			sum += sample;
+		}
+
+		GpuScopeStatistics statistics;
+		statistics.m_name = entry.first;
+		statistics.m_sampleCount = scope.m_count;
+		statistics.m_min = sorted.front();
+		statistics.m_max = sorted.back();
+		statistics.m_average = sum / sorted.size();
+		statistics.m_p99 = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+		result.push_back(statistics);
+	}
+	return result;
+}
+
+double GpuProfiler::getLastTime(const std::string& name) const
+{
+	auto it = m_scopes.find(name);
+	if (it == m_scopes.end() || it->second.m_samples.empty())
+	{
+		return 0.0;
+	}
+
+	const ScopeSamples& scope = it->second;
+	size_t last = (scope.m_next + SAMPLE_WINDOW - 1) % SAMPLE_WINDOW;
+	return scope.m_samples[std::min(last, scope.m_samples.size() - 1)];
+}
+
+void GpuProfiler::printStatistics(std::ostream& out) const
+{
+	if (!m_enabled)
+	{
+		out << "gpu profiler: timestamps not supported on this queue" << std::endl;
+		return;
+	}
+
+	for (const auto& statistics : getStatistics())
+	{
+		out << "gpu " << statistics.m_name << ": avg " << statistics.m_average << " ms, min " << statistics.m_min
+			<< " ms, p99 " << statistics.m_p99 << " ms (" << statistics.m_sampleCount << " samples)" << std::endl;
+	}
+}
+
+void GpuProfiler::writeCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	file << std::setprecision(6) << std::fixed;
+	file << "scope,samples,min_ms,avg_ms,p99_ms,max_ms\n";
+	for (const auto& statistics : getStatistics())
+	{
+		file << statistics.m_name << "," << statistics.m_sampleCount << "," << statistics.m_min << ","
+			<< statistics.m_average << "," << statistics.m_p99 << "," << statistics.m_max << "\n";
+	}
+}
+
+void GpuProfiler::writeJson(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	std::vector<GpuScopeStatistics> statisticsList = getStatistics();
+
+	file << std::setprecision(6) << std::fixed;
+	file << "{\n  \"timestampPeriodNs\": " << m_timestampPeriod << ",\n  \"scopes\": [";
+	for (size_t i = 0; i < statisticsList.size(); i++)
+	{
+		const GpuScopeStatistics& statistics = statisticsList[i];
+		file << (i == 0 ? "\n" : ",\n")
+			<< "    { \"name\": \"" << escapeJson(statistics.m_name) << "\", \"samples\": " << statistics.m_sampleCount
+			<< ", \"min_ms\": " << statistics.m_min << ", \"avg_ms\": " << statistics.m_average
+			<< ", \"p99_ms\": " << statistics.m_p99 << ", \"max_ms\": " << statistics.m_max << " }";
+	}
+	file << "\n  ]\n}\n";
+}
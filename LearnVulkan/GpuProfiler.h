@@ -0,0 +1,197 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * \brief 单个作用域的滚动统计
+ */
+struct GpuScopeStatistics
+{
+	// 作用域名称
+	std::string m_name;
+
+	// 累计的样本数，可能超过窗口大小
+	uint64_t m_sampleCount = 0;
+
+	// 以下为最近窗口内的统计，单位毫秒
+	double m_min = 0.0;
+	double m_average = 0.0;
+	double m_p99 = 0.0;
+	double m_max = 0.0;
+};
+
+/**
+ * \brief 基于时间戳查询的GPU分析器
+ *
+ * 每个飞行中的帧一个查询池。命令缓冲中的命名作用域前后各写一个时间戳，
+ * 结果在同一槽位下一次使用时读取，此时该帧的栅栏已经触发，读取不会阻塞。
+ * 每个作用域保留最近的样本，计算最小值、平均值和p99。
+ */
+class GpuProfiler
+{
+public:
+	/**
+	 * \brief 在作用域结束时自动写入结束时间戳
+	 */
+	class Scope
+	{
+	public:
+		Scope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+			: m_profiler(profiler), m_commandBuffer(commandBuffer), m_query(profiler.beginScope(commandBuffer, name))
+		{
+		}
+
+		~Scope()
+		{
+			m_profiler.endScope(m_commandBuffer, m_query);
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		GpuProfiler& m_profiler;
+		VkCommandBuffer m_commandBuffer;
+		uint32_t m_query;
+	};
+
+	GpuProfiler() = default;
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	/**
+	 * \brief 初始化，队列族不支持时间戳时分析器保持禁用，所有调用都不做事
+	 * \param physicalDevice
+	 * \param device
+	 * \param queueFamily 录制作用域的命令缓冲所提交的队列族
+	 * \param frameCount 飞行中的帧数
+	 * \param maxScopes 每帧最多的作用域数
+	 */
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount, uint32_t maxScopes = 64);
+
+	/**
+	 * \brief 销毁查询池
+	 */
+	void destroy();
+
+	/**
+	 * \brief 读取该槽位上一次的结果并重置查询池，必须在渲染流程之外、该帧的栅栏触发之后调用
+	 * \param commandBuffer
+	 * \param frameIndex
+	 */
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	/**
+	 * \brief 开始一个命名作用域
+	 * \param commandBuffer
+	 * \param name 必须在程序运行期间保持有效
+	 * \return 传给endScope的查询索引
+	 */
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+
+	/**
+	 * \brief 结束作用域
+	 * \param commandBuffer
+	 * \param query beginScope的返回值
+	 */
+	void endScope(VkCommandBuffer commandBuffer, uint32_t query);
+
+	/**
+	 * \brief 读取所有还没有读取的结果，调用前设备应该已经空闲
+	 */
+	void collectAll();
+
+	/**
+	 * \brief 所有作用域的统计，按名称排序
+	 * \return
+	 */
+	std::vector<GpuScopeStatistics> getStatistics() const;
+
+	/**
+	 * \brief 某个作用域最近一次的耗时
+	 * \param name
+	 * \return 单位毫秒，没有样本时为0
+	 */
+	double getLastTime(const std::string& name) const;
+
+	/**
+	 * \brief 打印统计信息
+	 * \param out
+	 */
+	void printStatistics(std::ostream& out) const;
+
+	/**
+	 * \brief 以CSV导出统计信息
+	 * \param path
+	 */
+	void writeCsv(const std::string& path) const;
+
+	/**
+	 * \brief 以JSON导出统计信息
+	 * \param path
+	 */
+	void writeJson(const std::string& path) const;
+
+	bool isEnabled() const
+	{
+		return m_enabled;
+	}
+
+private:
+	/**
+	 * \brief 一帧的查询
+	 */
+	struct FrameQueries
+	{
+		VkQueryPool m_pool = VK_NULL_HANDLE;
+
+		// 每个作用域的名称，作用域i使用查询2i和2i+1
+		std::vector<const char*> m_scopeNames;
+
+		// 查询池中有没有尚未读取的结果
+		bool m_pending = false;
+	};
+
+	/**
+	 * \brief 一个作用域最近的样本
+	 */
+	struct ScopeSamples
+	{
+		// 环形缓冲，单位毫秒
+		std::vector<double> m_samples;
+
+		// 下一个样本写入的位置
+		size_t m_next = 0;
+
+		uint64_t m_count = 0;
+	};
+
+	VkDevice m_device = VK_NULL_HANDLE;
+
+	bool m_enabled = false;
+
+	// 每个时间戳计数对应的纳秒数
+	double m_timestampPeriod = 1.0;
+
+	// 时间戳的有效位掩码
+	uint64_t m_timestampMask = ~0ull;
+
+	uint32_t m_maxScopes = 0;
+
+	std::vector<FrameQueries> m_frames;
+
+	// 当前录制的帧
+	uint32_t m_currentFrame = 0;
+
+	std::map<std::string, ScopeSamples> m_scopes;
+
+	void readResults(FrameQueries& frame);
+	void addSample(const char* name, double milliseconds);
+};
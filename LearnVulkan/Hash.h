@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief 计算一段内存的FNV-1a哈希
+ * \param data
+ * \param size
+ * \param seed 用于串联多段数据的初始值
+ * \return
+ */
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+/**
+ * \brief 把一个值的字节串联进哈希，只能用于没有填充字节的类型
+ * \param value
+ * \param seed
+ * \return
+ */
+template<typename T>
+uint64_t hashValue(const T& value, uint64_t seed)
+{
+	return hashBytes(&value, sizeof(T), seed);
+}
@@ -1,15 +1,42 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <glm/glm.hpp>
+
 #include <iostream>
 #include <stdexcept>
 #include <functional>
 #include <cstdlib>
+#include <cstring>
 #include <set>
 #include <vector>
 #include <fstream>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+#include <iterator>
+#include <array>
+#include <thread>
 
 #include "startup.h"
+#include "MappedFile.h"
+#include "DeviceMemoryAllocator.h"
+#include "StagingRing.h"
+#include "DeletionQueue.h"
+#include "Hash.h"
+#include "Json.h"
+#include "GpuProfiler.h"
+#include "CpuTrace.h"
+#include "JobSystem.h"
+#include "PipelineCompiler.h"
+#include "FileWatcher.h"
+#include "ShaderReflection.h"
+#include "PipelineLayoutCache.h"
+#include "DescriptorAllocator.h"
+#include "BindlessTable.h"
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
@@ -18,6 +45,14 @@ const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation
 
 const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+// 不是必需的，但支持时会提高设备评分的扩展
+const std::vector<const char*> optionalDeviceExtensions =
+{
+	"VK_EXT_extended_dynamic_state",
+	"VK_EXT_descriptor_indexing",
+	"VK_EXT_memory_budget",
+};
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -25,7 +60,7 @@ const bool enableValidationLayers = true;
 #endif
 
 /**
- * \brief DebugUtilsMessengerEXT
+ * \brief 创建DebugUtilsMessengerEXT对象
  * \param instance
  * \param pCreateInfo
  * \param pAllocator
@@ -49,7 +84,7 @@ VkResult CreateDebugUtilsMessengerEXT(VkInstance instance,
 }
 
 /**
- * \brief DebugUtilsMessengerEXT
+ * \brief 销毁DebugUtilsMessengerEXT对象
  * \param instance
  * \param callback
  * \param pAllocator
@@ -64,531 +99,3708 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 }
 
 /**
- * \brief 
+ * \brief 读取环境变量
+ * \param name
+ * \return 未设置时返回空字符串
+ */
+std::string getEnvironmentVariable(const char* name)
+{
+#ifdef _MSC_VER
+	// MSVC开启SDL检查时getenv会被当作错误
+	char* buffer = nullptr;
+	size_t length = 0;
+	std::string value;
+	if (_dupenv_s(&buffer, &length, name) == 0 && buffer != nullptr)
+	{
+		value = buffer;
+	}
+	free(buffer);
+	return value;
+#else
+	const char* value = getenv(name);
+	return value != nullptr ? value : "";
+#endif
+}
+
+/**
+ * \brief 管线缓存文件头，用来判断磁盘上的缓存是否属于当前设备和驱动
+ */
+struct PipelineCacheFileHeader
+{
+	// 固定的魔数，用于识别文件
+	uint32_t m_magic;
+
+	// 文件头本身的大小，结构变化时旧文件会被丢弃
+	uint32_t m_headerSize;
+
+	uint32_t m_vendorID;
+	uint32_t m_deviceID;
+	uint32_t m_driverVersion;
+	uint8_t m_pipelineCacheUUID[VK_UUID_SIZE];
+
+	// 紧跟在文件头后面的缓存数据的大小和哈希，用于发现截断或损坏
+	uint64_t m_dataSize;
+	uint64_t m_dataHash;
+};
+
+const uint32_t PIPELINE_CACHE_MAGIC = 0x4E56504C;	// "LPVN"
+
+/**
+ * \brief 队列族的索引
  */
 struct QueueFamilyIndices
 {
-	// ָֻ֧Ķ
+	// 支持绘制指令的队列族索引
 	int m_graphicsFamily = -1;
 
-	// ֱֵ֧Ķ
+	// 支持表现的队列族索引
 	int m_presentFamily = -1;
 
+	// 传输队列族索引，优先选择只支持传输的族，没有时与图形队列族相同
+	int m_transferFamily = -1;
+
+	// 计算队列族索引，优先选择不支持图形的族，没有时与图形队列族相同
+	int m_computeFamily = -1;
+
 	bool isComplete()
 	{
 		return m_graphicsFamily >= 0 && m_presentFamily >= 0;
 	}
+
+	bool hasDedicatedTransfer() const
+	{
+		return m_transferFamily != m_graphicsFamily;
+	}
+
+	bool hasDedicatedCompute() const
+	{
+		return m_computeFamily != m_graphicsFamily;
+	}
 };
 
 /**
- * \brief ֧ϸ
+ * \brief 交换链的支持细节
  */
 struct SwapChainSupportDetails
 {
-	// 
+	// 基础表面特性
 	VkSurfaceCapabilitiesKHR m_capabilities;
 
-	// ʽ
+	// 表面格式
 	std::vector<VkSurfaceFormatKHR> m_formats;
 
-	// õĳģʽ
+	// 可用的呈现模式
 	std::vector<VkPresentModeKHR> m_presentModes;
 };
 
-#ifdef HelloTriangle
-class HelloTriangleApplication
+/**
+ * \brief 呈现配置档，在延迟、功耗和吞吐之间取舍
+ */
+enum class PresentProfile
 {
-public:
-	void run()
-	{
-		initWindow();
-		initVulkan();
-		mainLoop();
-		cleanup();
-	}
+	// 尽快显示最新的一帧：MAILBOX，不排队
+	LowLatency,
 
-private:
-	// ھ
-	GLFWwindow* m_window;
+	// 跟随垂直同步，最少的图像和飞行帧，GPU空闲时间最多
+	PowerSaving,
 
-	// Vulkanʵ
-	VkInstance m_instance;
+	// 不撕裂的前提下让GPU一直有活干：较深的图像队列和飞行帧
+	MaxThroughput,
 
-	// Debugص
-	VkDebugUtilsMessengerEXT m_callback;
+	// 不受刷新率限制，用于测量渲染本身的速度，允许撕裂
+	Benchmark,
+};
 
-	// 豸
-	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+/**
+ * \brief 配置档对应的交换链参数
+ */
+struct PresentPolicy
+{
+	// 配置档名称
+	const char* m_name;
 
-	// ߼豸
-	VkDevice m_device;
+	// 按优先级排列的呈现模式，都不支持时使用必定支持的FIFO
+	std::vector<VkPresentModeKHR> m_presentModes;
 
-	// ͼλƶо
-	VkQueue m_graphicsQueue;
+	// 在表面要求的最少图像数之上额外申请的图像数
+	uint32_t m_extraImages;
 
-	// ڱ
-	VkSurfaceKHR m_surface;
+	// 默认的飞行帧数，命令行可以覆盖
+	uint32_t m_framesInFlight;
+};
 
-	// ֶо
-	VkQueue m_presentQueue;
+/**
+ * \brief 查询配置档的交换链参数
+ * \param profile
+ * \return
+ */
+PresentPolicy getPresentPolicy(PresentProfile profile)
+{
+	switch (profile)
+	{
+	case PresentProfile::LowLatency:
+		return { "low-latency", { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }, 1, 1 };
+	case PresentProfile::PowerSaving:
+		return { "power-saving", { VK_PRESENT_MODE_FIFO_KHR }, 0, 1 };
+	case PresentProfile::MaxThroughput:
+		return { "max-throughput", { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR }, 1, 3 };
+	case PresentProfile::Benchmark:
+		return { "benchmark", { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR }, 1, 3 };
+	}
+	throw std::runtime_error("unknown present profile!");
+}
+
+/**
+ * \brief 按名称解析配置档
+ * \param name
+ * \return
+ */
+PresentProfile parsePresentProfile(const std::string& name)
+{
+	const PresentProfile profiles[] = { PresentProfile::LowLatency, PresentProfile::PowerSaving, PresentProfile::MaxThroughput, PresentProfile::Benchmark };
+	for (PresentProfile profile : profiles)
+	{
+		if (name == getPresentPolicy(profile).m_name)
+		{
+			return profile;
+		}
+	}
+	throw std::runtime_error("unknown present profile: " + name);
+}
 
-	// 
-	VkSwapchainKHR m_swapChain;
+/**
+ * \brief 呈现模式的可读名称
+ * \param mode
+ * \return
+ */
+const char* presentModeName(VkPresentModeKHR mode)
+{
+	switch (mode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "fifo-relaxed";
+	default:
+		return "other";
+	}
+}
 
-	// ͼ
-	std::vector<VkImage> m_swapChainImages;
+/**
+ * \brief 固定工作量的场景，用于基准测试
+ */
+enum class Scene
+{
+	// 一个四边形
+	Triangle,
 
-	// ͼʽ
-	VkFormat m_swapChainImageFormat;
+	// 一次绘制大量小三角形，考验顶点和光栅化吞吐
+	ManyTriangles,
 
-	// Χ
-	VkExtent2D m_swapChainExtent;
+	// 大量小的绘制调用，考验CPU录制和驱动开销
+	ManyDraws,
 
-	// ͼͼ
-	std::vector<VkImageView> m_swapChainImageViews;
+	// 每次绘制都切换管线，考验管线绑定开销
+	ManyPipelines,
 
-	/**
-	 * \brief ʼ
-	 */
-	void initWindow()
-	{
-		glfwInit();
+	// 每帧通过暂存环形缓冲重新上传全部顶点数据
+	UploadHeavy,
+};
 
-		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+const Scene allScenes[] = { Scene::Triangle, Scene::ManyTriangles, Scene::ManyDraws, Scene::ManyPipelines, Scene::UploadHeavy };
 
-		m_window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+// 网格场景每边的格子数，顶点数(GRID_CELLS+1)^2不能超过16位索引的范围
+const uint32_t GRID_CELLS = 255;
 
-	}
+// 多绘制场景每帧的绘制调用数
+const uint32_t MANY_DRAWS_COUNT = 10000;
 
-	/**
-	 * \brief ʼVulkan
-	 */
-	void initVulkan()
+// 多管线场景的管线变体数和每帧的绘制调用数
+const uint32_t MANY_PIPELINES_COUNT = 64;
+const uint32_t MANY_PIPELINES_DRAWS = 1024;
+
+// 无绑定模式下图像和缓冲数组的大小，超过设备限制时取限制值
+const uint32_t BINDLESS_IMAGE_CAPACITY = 16384;
+const uint32_t BINDLESS_BUFFER_CAPACITY = 16384;
+
+// 无绑定描述符集固定在集合0，所有管线布局在这个集合上都兼容
+const uint32_t BINDLESS_SET = 0;
+
+// 无绑定模式下注册到缓冲数组的材质数，绘制按下标轮流使用
+const uint32_t MATERIAL_COUNT = 8;
+
+// 每个绘制的数据超过推送常量的限制时，动态uniform缓冲所在的集合和绑定号，与shader.vert一致
+const uint32_t DRAW_DATA_SET = 1;
+const uint32_t DRAW_DATA_BINDING = 0;
+
+/**
+ * \brief 场景的名称
+ * \param scene
+ * \return
+ */
+const char* sceneName(Scene scene)
+{
+	switch (scene)
 	{
-		createInstance();
-		setupDebugCallback();
-		createSurface();
-		pickPhysicalDevice();
-		createLogicalDevice();
-		createSwapChain();
-		createImageViews();
-		createGraphicsPipeline();
+	case Scene::Triangle:
+		return "triangle";
+	case Scene::ManyTriangles:
+		return "many-triangles";
+	case Scene::ManyDraws:
+		return "many-draws";
+	case Scene::ManyPipelines:
+		return "many-pipelines";
+	case Scene::UploadHeavy:
+		return "upload-heavy";
 	}
+	return "unknown";
+}
 
-	/**
-	 * \brief ѭ
-	 */
-	void mainLoop()
+/**
+ * \brief 按名称解析场景
+ * \param name
+ * \return
+ */
+Scene parseScene(const std::string& name)
+{
+	for (Scene scene : allScenes)
 	{
-		while (!glfwWindowShouldClose(m_window))
+		if (name == sceneName(scene))
 		{
-			glfwPollEvents();
+			return scene;
 		}
 	}
+	throw std::runtime_error("unknown scene: " + name);
+}
 
-	/**
-	 * \brief 
-	 */
-	void cleanup()
-	{
-		for(auto imageView : m_swapChainImageViews)
-		{
-			vkDestroyImageView(m_device, imageView, nullptr);
-		}
+/**
+ * \brief 运行配置，由命令行参数填充
+ */
+struct AppConfig
+{
+	// 无窗口模式：不创建GLFW窗口和表面，渲染到离屏图像环
+	bool m_headless = false;
 
-		vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
+	// 离屏图像环中的图像数量
+	uint32_t m_offscreenImageCount = 3;
 
-		vkDestroyDevice(m_device, nullptr);
+	// 渲染的帧数，0表示一直运行到窗口关闭
+	uint32_t m_frameCount = 0;
 
-		if (enableValidationLayers)
-		{
-			DestroyDebugUtilsMessengerEXT(m_instance, m_callback, nullptr);
-		}
+	// 呈现配置档
+	PresentProfile m_presentProfile = PresentProfile::LowLatency;
 
-		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
-		vkDestroyInstance(m_instance, nullptr);
+	// 同时在飞行中的帧数，越大吞吐越高，但输入到显示的延迟也越大，0表示使用配置档的默认值
+	uint32_t m_framesInFlight = 0;
 
-		glfwDestroyWindow(m_window);
+	// 管线缓存文件路径，为空时不读写磁盘
+	std::string m_pipelineCachePath = "pipeline_cache.bin";
 
-		glfwTerminate();
-	}
+	// 强制使用的物理设备：枚举索引、UUID或名称的一部分，为空时按评分自动选择
+	std::string m_deviceOverride = getEnvironmentVariable("LEARNVULKAN_DEVICE");
 
-	/**
-	 * \brief Vulkanʵ
-	 */
-	void createInstance()
-	{
-		if (enableValidationLayers && !checkValidationLayerSupport())
-		{
-			throw std::runtime_error("validation layers requested, but not available!");
-		}
+	// 渲染分辨率
+	uint32_t m_width = WIDTH;
+	uint32_t m_height = HEIGHT;
 
-		VkApplicationInfo appInfo{};
-		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-		appInfo.pApplicationName = "Hello Triangle";
-		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.pEngineName = "No Engine";
-		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+	// GPU分析结果的导出路径，扩展名为.json时导出JSON，否则导出CSV，为空时不导出
+	std::string m_gpuProfilePath;
 
-		VkInstanceCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-		createInfo.pApplicationInfo = &appInfo;
+	// CPU时间线的导出路径，为空时不记录
+	std::string m_cpuTracePath;
 
-		// չ֧
-		auto extensions = getRequiredExtensions();
-		createInfo.enabledExtensionCount = extensions.size();
-		createInfo.ppEnabledExtensionNames = extensions.data();
+	// 渲染的场景
+	Scene m_scene = Scene::Triangle;
 
-		// УʱʹУ
-		if (enableValidationLayers)
-		{
-			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-			createInfo.ppEnabledLayerNames = validationLayers.data();
-		}
-		else
-		{
-			createInfo.enabledLayerCount = 0;
-		}
+	// 基准测试结果的导出路径，为空时不导出
+	std::string m_benchmarkPath;
 
-		if (vkCreateInstance(&createInfo, nullptr, &m_instance) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to create instance!");
-		}
-	}
+	// 暂存环形缓冲中每帧区域的字节数，一帧内的上传总量不能超过它
+	VkDeviceSize m_stagingFrameSize = 4ull << 20;
 
-	/**
-	 * \brief У
-	 * \return
-	 */
-	bool checkValidationLayerSupport()
-	{
-		uint32_t layerCount;
-		vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+	// 任务系统的后台线程数，默认每个额外的核心一个，主线程也参与执行任务
+	uint32_t m_jobThreads = std::max(1u, std::thread::hardware_concurrency()) - 1;
 
-		// ȡпõУб
-		std::vector<VkLayerProperties> availableLayers(layerCount);
-		vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+	// 绘制列表拆分成的并行录制任务数，0表示在主线程上直接录制到主命令缓冲，
+	// 命令行选项沿用任务系统之前的--record-threads
+	uint32_t m_recordJobs = 0;
 
-		// ǷбָУ
-		for (const char* layerName : validationLayers)
-		{
-			bool layerFound = false;
+	// 管线还在后台编译时跳过使用它的绘制，否则用通用管线代替
+	bool m_skipPendingPipelines = false;
 
-			for (const auto& layerProperties : availableLayers)
-			{
-				if (strcmp(layerName, layerProperties.layerName) == 0)
-				{
-					layerFound = true;
-					break;
-				}
-			}
+	// 着色器变体清单，为空或文件不存在时只有default变体
+	std::string m_shaderVariantsPath = "shaders/shader_variants.txt";
 
-			if (!layerFound)
-			{
-				return false;
-			}
-		}
+	// 使用的着色器变体，取值见清单
+	std::string m_vertexVariant = "default";
+	std::string m_fragmentVariant = "default";
 
-		return true;
-	}
+	// 设备支持时使用VK_EXT_extended_dynamic_state，减少只差剔除方式、拓扑和深度状态的管线
+	bool m_extendedDynamicState = true;
 
-	/**
-	 * \brief ǷУ㣬չб
-	 * \return
-	 */
-	std::vector<const char*> getRequiredExtensions()
-	{
-		uint32_t glfwExtensionCount = 0;
+	// 监视SPIR-V和变体清单，修改后在后台重新创建管线，在帧与帧之间换上
+	bool m_watchShaders = false;
 
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	// 着色器源文件所在的目录，监视时源文件修改后先调用glslangValidator编译，为空时只监视SPIR-V
+	std::string m_shaderSourceDirectory;
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	// 设备支持描述符索引时使用无绑定描述符表
+	bool m_bindless = false;
 
-		if (enableValidationLayers)
-		{
-			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-		}
+	// 每个绘制的数据总是通过动态uniform缓冲传入，用来对比推送常量路径，否则只在超过设备限制时使用
+	bool m_drawDataUniformBuffer = false;
+};
 
-		return extensions;
-	}
+/**
+ * \brief 解析命令行参数
+ * \param argc
+ * \param argv
+ * \return
+ */
+AppConfig parseCommandLine(int argc, char** argv)
+{
+	AppConfig config;
 
-	/**
-	 * \brief Debugص
-	 */
-	void setupDebugCallback()
+	for (int i = 1; i < argc; i++)
 	{
-		if (!enableValidationLayers)
-		{
-			return;
-		}
+		std::string arg = argv[i];
 
-		VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-		createInfo.messageSeverity =
-			VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-			VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-		createInfo.messageType =
-			VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-			VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-			VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-		createInfo.pfnUserCallback = debugCallback;
-		createInfo.pUserData = nullptr;	// Optional
+		// 读取当前选项后面的数值参数
+		auto nextValue = [&]() -> uint32_t
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			return static_cast<uint32_t>(std::stoul(argv[++i]));
+		};
 
-		if (CreateDebugUtilsMessengerEXT(m_instance, &createInfo, nullptr, &m_callback) != VK_SUCCESS)
+		if (arg == "--headless")
+		{
+			config.m_headless = true;
+		}
+		else if (arg == "--frames")
+		{
+			config.m_frameCount = nextValue();
+		}
+		else if (arg == "--frames-in-flight")
+		{
+			config.m_framesInFlight = std::max(1u, nextValue());
+		}
+		else if (arg == "--present")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_presentProfile = parsePresentProfile(argv[++i]);
+		}
+		else if (arg == "--offscreen-images")
+		{
+			config.m_offscreenImageCount = std::max(1u, nextValue());
+		}
+		else if (arg == "--pipeline-cache")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_pipelineCachePath = argv[++i];
+		}
+		else if (arg == "--gpu-profile")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_gpuProfilePath = argv[++i];
+		}
+		else if (arg == "--cpu-trace")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_cpuTracePath = argv[++i];
+		}
+		else if (arg == "--scene")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_scene = parseScene(argv[++i]);
+		}
+		else if (arg == "--benchmark")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_benchmarkPath = argv[++i];
+		}
+		else if (arg == "--device")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_deviceOverride = argv[++i];
+		}
+		else if (arg == "--width")
+		{
+			config.m_width = nextValue();
+		}
+		else if (arg == "--height")
+		{
+			config.m_height = nextValue();
+		}
+		else if (arg == "--staging-mib")
+		{
+			config.m_stagingFrameSize = static_cast<VkDeviceSize>(std::max(1u, nextValue())) << 20;
+		}
+		else if (arg == "--job-threads")
+		{
+			config.m_jobThreads = nextValue();
+		}
+		else if (arg == "--record-threads")
+		{
+			config.m_recordJobs = nextValue();
+		}
+		else if (arg == "--skip-pending-pipelines")
+		{
+			config.m_skipPendingPipelines = true;
+		}
+		else if (arg == "--shader-variants" || arg == "--vert-variant" || arg == "--frag-variant")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			std::string& target = arg == "--shader-variants" ? config.m_shaderVariantsPath
+				: arg == "--vert-variant" ? config.m_vertexVariant : config.m_fragmentVariant;
+			target = argv[++i];
+		}
+		else if (arg == "--no-extended-dynamic-state")
+		{
+			config.m_extendedDynamicState = false;
+		}
+		else if (arg == "--bindless")
+		{
+			config.m_bindless = true;
+		}
+		else if (arg == "--draw-data-ubo")
+		{
+			config.m_drawDataUniformBuffer = true;
+		}
+		else if (arg == "--watch-shaders")
+		{
+			config.m_watchShaders = true;
+		}
+		else if (arg == "--shader-source-dir")
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error("missing value for " + arg + "!");
+			}
+			config.m_shaderSourceDirectory = argv[++i];
+			config.m_watchShaders = true;
+		}
+		else
+		{
+			throw std::runtime_error("unknown argument: " + arg);
+		}
+	}
+
+	// 无窗口模式没有关闭事件，必须有固定的帧数
+	if (config.m_headless && config.m_frameCount == 0)
+	{
+		config.m_frameCount = 1000;
+	}
+
+	if (config.m_framesInFlight == 0)
+	{
+		config.m_framesInFlight = getPresentPolicy(config.m_presentProfile).m_framesInFlight;
+	}
+
+	return config;
+}
+
+/**
+ * \brief 参与评分的物理设备
+ */
+struct DeviceCandidate
+{
+	VkPhysicalDevice m_device = VK_NULL_HANDLE;
+
+	// vkEnumeratePhysicalDevices返回的索引
+	uint32_t m_index = 0;
+
+	VkPhysicalDeviceProperties m_properties;
+
+	// 设备UUID，驱动不支持Vulkan 1.1时全为0
+	uint8_t m_uuid[VK_UUID_SIZE] = {};
+
+	// 设备本地堆的总大小
+	VkDeviceSize m_deviceLocalBytes = 0;
+
+	// 是否满足运行的最低需求
+	bool m_suitable = false;
+
+	// 评分，越高越优先
+	uint64_t m_score = 0;
+};
+
+/**
+ * \brief 把UUID格式化为8-4-4-4-12形式的十六进制字符串
+ * \param uuid
+ * \return
+ */
+std::string formatUuid(const uint8_t uuid[VK_UUID_SIZE])
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string text;
+	for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+	{
+		if (i == 4 || i == 6 || i == 8 || i == 10)
+		{
+			text += '-';
+		}
+		text += digits[uuid[i] >> 4];
+		text += digits[uuid[i] & 0xF];
+	}
+	return text;
+}
+
+/**
+ * \brief 顶点数据，成员按顶点着色器输入的location顺序紧密排列，顶点输入描述由反射生成
+ */
+struct Vertex
+{
+	glm::vec2 m_pos;
+	glm::vec3 m_color;
+};
+
+const std::vector<Vertex> vertices =
+{
+	{ { -0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
+	{ { 0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f } },
+	{ { 0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } },
+	{ { -0.5f, 0.5f }, { 1.0f, 1.0f, 1.0f } },
+};
+
+const std::vector<uint16_t> indices = { 0, 1, 2, 2, 3, 0 };
+
+/**
+ * \brief 每个绘制的数据，与shader.vert中的DrawData块一致，成员紧密排列
+ */
+struct DrawData
+{
+	// 顶点位置的变换
+	glm::mat4 m_transform;
+
+	// 材质下标，无绑定模式下是材质缓冲在无绑定缓冲数组中的句柄
+	uint32_t m_materialIndex;
+};
+
+/**
+ * \brief 无绑定模式下一个材质的数据，与shader.vert中读取的布局一致
+ */
+struct Material
+{
+	// 与顶点颜色相乘的颜色，w未使用
+	glm::vec4 m_tint;
+};
+
+/**
+ * \brief 生成铺满视口的网格，每个格子两个三角形
+ * \param cells 每边的格子数
+ * \param gridVertices
+ * \param gridIndices
+ */
+void generateGrid(uint32_t cells, std::vector<Vertex>& gridVertices, std::vector<uint16_t>& gridIndices)
+{
+	uint32_t side = cells + 1;
+	if (side * side > std::numeric_limits<uint16_t>::max() + 1u)
+	{
+		throw std::runtime_error("grid is too large for 16-bit indices!");
+	}
+
+	gridVertices.clear();
+	gridVertices.reserve(side * side);
+	for (uint32_t y = 0; y < side; y++)
+	{
+		for (uint32_t x = 0; x < side; x++)
+		{
+			float u = static_cast<float>(x) / cells;
+			float v = static_cast<float>(y) / cells;
+			gridVertices.push_back({ { u * 2.0f - 1.0f, v * 2.0f - 1.0f }, { u, v, 1.0f - u } });
+		}
+	}
+
+	gridIndices.clear();
+	gridIndices.reserve(cells * cells * 6);
+	for (uint32_t y = 0; y < cells; y++)
+	{
+		for (uint32_t x = 0; x < cells; x++)
+		{
+			uint16_t topLeft = static_cast<uint16_t>(y * side + x);
+			uint16_t topRight = static_cast<uint16_t>(topLeft + 1);
+			uint16_t bottomLeft = static_cast<uint16_t>(topLeft + side);
+			uint16_t bottomRight = static_cast<uint16_t>(bottomLeft + 1);
+
+			// 与四边形相同的顺时针环绕
+			gridIndices.insert(gridIndices.end(), { topLeft, topRight, bottomRight, bottomRight, bottomLeft, topLeft });
+		}
+	}
+}
+
+/**
+ * \brief 一次运行的基准测试结果，预热帧不计入
+ */
+struct BenchmarkResult
+{
+	std::string m_scene;
+	std::string m_deviceName;
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+
+	// 任务系统的后台线程数
+	uint32_t m_jobThreads = 0;
+
+	// 并行录制任务数，0表示在主线程上内联录制
+	uint32_t m_recordJobs = 0;
+
+	// 计入统计的帧数
+	uint64_t m_frames = 0;
+
+	// CPU上drawFrame的耗时，单位毫秒
+	double m_cpuFrameAverage = 0.0;
+	double m_cpuFrameP99 = 0.0;
+
+	// GPU上一帧命令的耗时，设备不支持时间戳时为0
+	double m_gpuFrameAverage = 0.0;
+
+	uint64_t m_drawsPerFrame = 0;
+	double m_drawCallsPerSecond = 0.0;
+
+	// 有绘制因为管线还在编译而回退的帧数，包括预热阶段
+	uint64_t m_pipelineFallbackFrames = 0;
+
+	// 每帧调用vkAllocateMemory的次数，稳定状态下应该为0
+	double m_allocationsPerFrame = 0.0;
+
+	double m_uploadBytesPerFrame = 0.0;
+	double m_framesPerSecond = 0.0;
+};
+
+/**
+ * \brief 把基准测试结果写成JSON数组
+ * \param path
+ * \param results
+ */
+void writeBenchmarkReport(const std::string& path, const std::vector<BenchmarkResult>& results)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	file << "[";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		file << (i == 0 ? "\n" : ",\n")
+			<< "  { \"scene\": \"" << escapeJson(result.m_scene) << "\", \"device\": \"" << escapeJson(result.m_deviceName) << "\""
+			<< ", \"width\": " << result.m_width << ", \"height\": " << result.m_height
+			<< ", \"job_threads\": " << result.m_jobThreads << ", \"record_threads\": " << result.m_recordJobs
+			<< ", \"frames\": " << result.m_frames
+			<< ", \"cpu_frame_ms_avg\": " << result.m_cpuFrameAverage << ", \"cpu_frame_ms_p99\": " << result.m_cpuFrameP99
+			<< ", \"gpu_frame_ms_avg\": " << result.m_gpuFrameAverage
+			<< ", \"draws_per_frame\": " << result.m_drawsPerFrame << ", \"draw_calls_per_s\": " << result.m_drawCallsPerSecond
+			<< ", \"pipeline_fallback_frames\": " << result.m_pipelineFallbackFrames
+			<< ", \"allocations_per_frame\": " << result.m_allocationsPerFrame
+			<< ", \"upload_bytes_per_frame\": " << result.m_uploadBytesPerFrame
+			<< ", \"fps\": " << result.m_framesPerSecond << " }";
+	}
+	file << "\n]\n";
+}
+
+/**
+ * \brief 每个飞行中的帧独占的资源
+ */
+struct FrameData
+{
+	// 命令池，每帧独立以便整体重置而不是逐个释放命令缓冲
+	VkCommandPool m_commandPool = VK_NULL_HANDLE;
+
+	// 主命令缓冲
+	VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+
+	// 每个录制任务一个命令池，命令池不是线程安全的，同一时刻只能由一个线程使用
+	std::vector<VkCommandPool> m_secondaryPools;
+
+	// 每个录制任务的次级命令缓冲，由主命令缓冲执行
+	std::vector<VkCommandBuffer> m_secondaryBuffers;
+
+	// 图像已获取的信号量，无窗口模式下不使用
+	VkSemaphore m_imageAvailableSemaphore = VK_NULL_HANDLE;
+
+	// 该帧提交完成的栅栏
+	VkFence m_inFlightFence = VK_NULL_HANDLE;
+
+	// 不使用推送常量时每个绘制的数据，持久映射，每个绘制占一个对齐后的槽位
+	VkBuffer m_drawDataBuffer = VK_NULL_HANDLE;
+	MemoryAllocation m_drawDataMemory;
+
+	// 以动态偏移选择绘制槽位的描述符集
+	VkDescriptorSet m_drawDataSet = VK_NULL_HANDLE;
+};
+
+/**
+ * \brief 多管线场景中的一种绘制状态
+ */
+struct SceneVariant
+{
+	PipelineCompiler::Handle m_pipeline = 0;
+
+	// 开启扩展动态状态时在录制时设置，否则已经固定在管线中
+	VkCullModeFlags m_cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace m_frontFace = VK_FRONT_FACE_CLOCKWISE;
+};
+
+/**
+ * \brief 一次着色器热重载在任务线程上准备好的结果，由主线程在帧与帧之间换上
+ */
+struct ShaderReload
+{
+	// 用新的SPIR-V创建的着色器模块和代码哈希
+	VkShaderModule m_vertShaderModule = VK_NULL_HANDLE;
+	VkShaderModule m_fragShaderModule = VK_NULL_HANDLE;
+	ShaderReflection m_vertReflection;
+	ShaderReflection m_fragReflection;
+
+	// 使用新模块的通用管线状态，着色器和清单都没有变化时不创建管线
+	GraphicsPipelineState m_state;
+	VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+	// 失败时的错误信息，此时没有留下任何对象
+	std::string m_error;
+};
+
+#ifdef HelloTriangle
+class HelloTriangleApplication
+{
+public:
+	explicit HelloTriangleApplication(const AppConfig& config = AppConfig())
+		: m_config(config)
+	{
+	}
+
+	/**
+	 * \brief 最近一次运行的基准测试结果
+	 * \return
+	 */
+	const BenchmarkResult& getBenchmarkResult() const
+	{
+		return m_benchmarkResult;
+	}
+
+	void run()
+	{
+		CpuTrace::setEnabled(!m_config.m_cpuTracePath.empty());
+		CpuTrace::setThreadName("main");
+
+		// 调用run的线程成为任务系统的主线程，GLFW的调用必须留在这里
+		m_jobs.init(m_config.m_jobThreads);
+
+		initWindow();
+		initVulkan();
+		mainLoop();
+		cleanup();
+		m_jobs.destroy();
+
+		// 导出启动和每帧各阶段的时间线，用chrome://tracing或Perfetto打开
+		if (CpuTrace::isEnabled())
+		{
+			CpuTrace::writeChromeTrace(m_config.m_cpuTracePath);
+			std::cout << "cpu trace written to " << m_config.m_cpuTracePath << std::endl;
+		}
+	}
+
+private:
+	// 运行配置
+	AppConfig m_config;
+
+	// 窗口句柄
+	GLFWwindow* m_window = nullptr;
+
+	// Vulkan实例
+	VkInstance m_instance;
+
+	// Debug回调
+	VkDebugUtilsMessengerEXT m_callback;
+
+	// 物理设备
+	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+
+	// 逻辑设备
+	VkDevice m_device;
+
+	// 图形绘制队列句柄
+	VkQueue m_graphicsQueue;
+
+	// 窗口表面，无窗口模式下为空
+	VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+
+	// 表现队列句柄
+	VkQueue m_presentQueue;
+
+	// 传输队列句柄，没有专用队列族时与图形队列相同
+	VkQueue m_transferQueue;
+
+	// 计算队列句柄，没有专用队列族时与图形队列相同
+	VkQueue m_computeQueue;
+
+	// 逻辑设备使用的队列族
+	QueueFamilyIndices m_queueFamilies;
+
+	// 交换链句柄，无窗口模式下为空
+	VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
+
+	// 交换链图像
+	std::vector<VkImage> m_swapChainImages;
+
+	// 交换链图像格式
+	VkFormat m_swapChainImageFormat;
+
+	// 交换链范围
+	VkExtent2D m_swapChainExtent;
+
+	// 交换链使用的呈现模式
+	VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+	// 上一次呈现返回的时刻，用于测量呈现间隔
+	std::chrono::steady_clock::time_point m_lastPresentTime;
+
+	// 呈现间隔的统计，单位毫秒
+	uint64_t m_presentCount = 0;
+	double m_presentIntervalSum = 0.0;
+	double m_presentIntervalMin = std::numeric_limits<double>::max();
+	double m_presentIntervalMax = 0.0;
+
+	// 图像视图
+	std::vector<VkImageView> m_swapChainImageViews;
+
+	// 设备内存子分配器
+	DeviceMemoryAllocator m_allocator;
+
+	// 离屏图像的设备内存，仅无窗口模式使用
+	std::vector<MemoryAllocation> m_offscreenImageMemory;
+
+	// 离屏图像环中下一帧使用的图像索引
+	uint32_t m_nextOffscreenImage = 0;
+
+	// 渲染流程
+	VkRenderPass m_renderPass;
+
+	// 由着色器反射生成的描述符集布局和管线布局，按内容去重
+	PipelineLayoutCache m_layoutCache;
+
+	// 当前着色器的管线布局，由m_layoutCache持有
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+
+	// 每帧的临时描述符集和内容固定的长期描述符集
+	DescriptorAllocator m_descriptorAllocator;
+
+	// 设备是否启用了无绑定模式需要的描述符索引特性
+	bool m_bindless = false;
+
+	// 无绑定模式下的图像和缓冲数组，在每个命令缓冲开始时绑定一次
+	BindlessTable m_bindlessTable;
+
+	// 每个绘制的数据是否通过推送常量传入，否则使用每帧的动态uniform缓冲
+	bool m_drawDataPushConstants = true;
+
+	// 动态uniform缓冲中相邻两个绘制的偏移差，按minUniformBufferOffsetAlignment对齐
+	VkDeviceSize m_drawDataStride = 0;
+
+	// 通用图形管线，同步创建，其他管线编译完成之前用它代替，由m_pipelineCompiler持有
+	VkPipeline m_graphicsPipeline;
+
+	// 设备是否启用了VK_EXT_extended_dynamic_state
+	bool m_extendedDynamicState = false;
+
+	// 扩展动态状态的命令，不在加载器导出的核心函数中，需要从设备获取
+	PFN_vkCmdSetCullModeEXT m_vkCmdSetCullModeEXT = nullptr;
+	PFN_vkCmdSetFrontFaceEXT m_vkCmdSetFrontFaceEXT = nullptr;
+	PFN_vkCmdSetPrimitiveTopologyEXT m_vkCmdSetPrimitiveTopologyEXT = nullptr;
+	PFN_vkCmdSetDepthTestEnableEXT m_vkCmdSetDepthTestEnableEXT = nullptr;
+	PFN_vkCmdSetDepthWriteEnableEXT m_vkCmdSetDepthWriteEnableEXT = nullptr;
+	PFN_vkCmdSetDepthCompareOpEXT m_vkCmdSetDepthCompareOpEXT = nullptr;
+
+	// 着色器模块，所有管线共用
+	VkShaderModule m_vertShaderModule = VK_NULL_HANDLE;
+	VkShaderModule m_fragShaderModule = VK_NULL_HANDLE;
+
+	// 着色器代码的哈希，作为管线状态的一部分
+	uint64_t m_vertShaderHash = 0;
+	uint64_t m_fragShaderHash = 0;
+
+	// 着色器的输入输出、描述符、推送常量和特化常量
+	ShaderReflection m_vertReflection;
+	ShaderReflection m_fragReflection;
+
+	// 创建通用管线使用的状态，各个变体都从它派生
+	GraphicsPipelineState m_graphicsPipelineState;
+
+	// 开启热重载时监视的着色器文件
+	FileWatcher m_shaderWatcher;
+
+	// 检测到修改、还没有开始重载
+	bool m_shaderReloadPending = false;
+
+	// 第一次检测到修改的时间，用于统计从保存到换上新管线的耗时
+	std::chrono::steady_clock::time_point m_shaderChangeTime;
+
+	// 需要先编译成SPIR-V的源文件
+	std::vector<std::string> m_changedShaderSources;
+
+	// 正在任务线程上进行的重载和它的结果，同一时间最多一个
+	bool m_shaderReloadInFlight = false;
+	JobCounter m_shaderReloadJob;
+	ShaderReload m_shaderReload;
+
+	// 所有图形管线的表，按状态去重，在任务线程上编译
+	PipelineCompiler m_pipelineCompiler;
+
+	// 管线缓存，启动时从磁盘载入，退出时写回
+	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+
+	// 管线缓存是否由磁盘上的有效数据初始化
+	bool m_pipelineCacheWarm = false;
+
+	// 每个交换链图像对应的帧缓冲
+	std::vector<VkFramebuffer> m_swapChainFramebuffers;
+
+	// 每个飞行中的帧的资源
+	std::vector<FrameData> m_frames;
+
+	// 当前帧在m_frames中的索引
+	uint32_t m_currentFrame = 0;
+
+	// 从0开始递增的帧序号，用于判断退役的对象何时可以销毁
+	uint64_t m_frameNumber = 0;
+
+	// 退役但可能仍被飞行中的帧使用的对象
+	DeletionQueue m_deletionQueue;
+
+	// 窗口大小改变后置位，在下一次呈现后重建交换链
+	bool m_framebufferResized = false;
+
+	// 每个交换链图像的渲染完成信号量，图像呈现之后才能复用，无窗口模式下不使用
+	std::vector<VkSemaphore> m_renderFinishedSemaphores;
+
+	// 每个交换链图像正在被哪一帧的栅栏使用
+	std::vector<VkFence> m_imagesInFlight;
+
+	// 每个飞行中的帧一段区域的暂存环形缓冲，所有上传都经过它
+	StagingRing m_stagingRing;
+
+	// GPU时间戳分析器
+	GpuProfiler m_gpuProfiler;
+
+	// 任务系统，录制、加载等可以拆分的工作在所有核心上执行
+	JobSystem m_jobs;
+
+	// 顶点缓冲
+	VkBuffer m_vertexBuffer;
+	MemoryAllocation m_vertexBufferMemory;
+
+	// 索引缓冲
+	VkBuffer m_indexBuffer;
+	MemoryAllocation m_indexBufferMemory;
+
+	// 无绑定模式下所有材质的存储缓冲，每个材质按对齐后的步长占一段
+	VkBuffer m_materialBuffer = VK_NULL_HANDLE;
+	MemoryAllocation m_materialBufferMemory;
+
+	// 每个材质在无绑定缓冲数组中的句柄
+	std::vector<uint32_t> m_materialHandles;
+
+	// 当前场景的几何数据
+	std::vector<Vertex> m_sceneVertices;
+	std::vector<uint16_t> m_sceneIndices;
+
+	// 多管线场景的绘制状态
+	std::vector<SceneVariant> m_sceneVariants;
+
+	// 上传密集场景每个飞行中的帧一个顶点缓冲，每帧重新上传
+	std::vector<VkBuffer> m_dynamicVertexBuffers;
+	std::vector<MemoryAllocation> m_dynamicVertexBufferMemory;
+
+	// 累计录制的绘制调用数
+	uint64_t m_drawCount = 0;
+
+	// 最近一次运行的基准测试结果
+	BenchmarkResult m_benchmarkResult;
+
+	/**
+	 * \brief 初始化窗口
+	 */
+	void initWindow()
+	{
+		// 无窗口模式下完全不使用GLFW
+		if (m_config.m_headless)
+		{
+			return;
+		}
+
+		glfwInit();
+
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+		m_window = glfwCreateWindow(m_config.m_width, m_config.m_height, "Vulkan", nullptr, nullptr);
+		glfwSetWindowUserPointer(m_window, this);
+		glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
+
+	}
+
+	/**
+	 * \brief 窗口帧缓冲大小改变的回调，新的大小在重建交换链时重新查询
+	 * \param window
+	 */
+	static void framebufferResizeCallback(GLFWwindow* window, int /*width*/, int /*height*/)
+	{
+		auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+		app->m_framebufferResized = true;
+	}
+
+	/**
+	 * \brief 初始化Vulkan
+	 */
+	void initVulkan()
+	{
+		CpuTraceScope traceScope("initVulkan");
+
+		createInstance();
+		setupDebugCallback();
+		createSurface();
+		pickPhysicalDevice();
+
+		// 读取和校验管线缓存文件与创建逻辑设备互不依赖，放到任务线程上
+		std::vector<char> pipelineCacheData;
+		JobCounter pipelineCacheLoaded;
+		m_jobs.run([&]() { pipelineCacheData = loadPipelineCacheData(); }, &pipelineCacheLoaded);
+
+		try
+		{
+			createLogicalDevice();
+			m_allocator.init(m_physicalDevice, m_device);
+			m_layoutCache.init(m_device);
+			createBindlessTable();
+			selectDrawDataPath();
+		}
+		catch(...)
+		{
+			// 任务写入的是这个函数的局部变量，离开函数之前必须等它结束，它自己的错误不再关心
+			try
+			{
+				m_jobs.wait(pipelineCacheLoaded);
+			}
+			catch(...)
+			{
+			}
+			throw;
+		}
+		m_jobs.wait(pipelineCacheLoaded);
+		createPipelineCache(pipelineCacheData);
+		m_pipelineCompiler.init(m_device, m_pipelineCache, m_jobs);
+		createSwapChain();
+		createImageViews();
+		createRenderPass();
+		createGraphicsPipeline();
+		createFramebuffers();
+		createFrameResources();
+		m_gpuProfiler.init(m_physicalDevice, m_device, m_queueFamilies.m_graphicsFamily, static_cast<uint32_t>(m_frames.size()));
+		m_descriptorAllocator.init(m_device, static_cast<uint32_t>(m_frames.size()));
+		createDrawDataBuffers();
+		createStagingRing();
+		createGeometryBuffers();
+		createMaterials();
+		createSyncObjects();
+
+		if(m_config.m_watchShaders)
+		{
+			createShaderWatcher();
+		}
+	}
+
+	/**
+	 * \brief 主循环
+	 */
+	void mainLoop()
+	{
+		uint32_t frameIndex = 0;
+		auto startTime = std::chrono::steady_clock::now();
+
+		// 前几帧包含首次上传和驱动的延迟初始化，不计入基准测试
+		uint32_t warmupFrames = std::min<uint32_t>(m_config.m_frameCount / 10, 60);
+		std::vector<double> cpuFrameTimes;
+		cpuFrameTimes.reserve(m_config.m_frameCount);
+		auto steadyStartTime = startTime;
+		uint64_t steadyStartAllocations = m_allocator.getDeviceAllocationCount();
+		uint64_t steadyStartDraws = 0;
+		VkDeviceSize steadyStartUploads = 0;
+
+		while (true)
+		{
+			if (m_config.m_headless)
+			{
+				if (frameIndex >= m_config.m_frameCount)
+				{
+					break;
+				}
+			}
+			else
+			{
+				if (glfwWindowShouldClose(m_window) || (m_config.m_frameCount != 0 && frameIndex >= m_config.m_frameCount))
+				{
+					break;
+				}
+
+				glfwPollEvents();
+			}
+
+			// 执行其他线程提交的需要在主线程上进行的工作
+			m_jobs.pumpMainThread();
+
+			// 上一帧已经提交、这一帧还没有开始录制，在这里换上重载的管线
+			updateShaderReload();
+
+			if (frameIndex == warmupFrames)
+			{
+				steadyStartTime = std::chrono::steady_clock::now();
+				steadyStartAllocations = m_allocator.getDeviceAllocationCount();
+				steadyStartDraws = m_drawCount;
+				steadyStartUploads = m_stagingRing.getBytesUploaded();
+			}
+
+			auto frameStartTime = std::chrono::steady_clock::now();
+			drawFrame();
+			if (frameIndex >= warmupFrames)
+			{
+				cpuFrameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStartTime).count());
+			}
+			frameIndex++;
+		}
+
+		// 等待所有提交的工作完成后再统计耗时和清理
+		vkDeviceWaitIdle(m_device);
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		if (frameIndex > 0 && seconds > 0.0)
+		{
+			std::cout << frameIndex << " frames in " << seconds << " s, "
+				<< frameIndex / seconds << " fps ("
+				<< (m_config.m_headless ? "headless" : "windowed") << ")" << std::endl;
+		}
+
+		if (m_presentCount > 1)
+		{
+			std::cout << "present interval (" << presentModeName(m_presentMode) << "): avg "
+				<< m_presentIntervalSum / (m_presentCount - 1) << " ms, min " << m_presentIntervalMin
+				<< " ms, max " << m_presentIntervalMax << " ms" << std::endl;
+		}
+
+		// 最后几帧的时间戳还没有被读取
+		m_gpuProfiler.collectAll();
+		m_gpuProfiler.printStatistics(std::cout);
+		if (!m_config.m_gpuProfilePath.empty())
+		{
+			const std::string& path = m_config.m_gpuProfilePath;
+			if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0)
+			{
+				m_gpuProfiler.writeJson(path);
+			}
+			else
+			{
+				m_gpuProfiler.writeCsv(path);
+			}
+		}
+
+		std::cout << "staging ring: " << m_frames.size() << " x " << (m_stagingRing.getFrameSize() >> 10) << " KiB, "
+			<< m_stagingRing.getBytesUploaded() << " bytes uploaded, "
+			<< m_stagingRing.getRejectedUploads() << " uploads deferred" << std::endl;
+
+		if(m_descriptorAllocator.getPoolCount() != 0)
+		{
+			std::cout << "descriptor allocator: " << m_descriptorAllocator.getPoolCount() << " pools, "
+				<< m_descriptorAllocator.getTransientSetCount() << " transient sets, " << m_descriptorAllocator.getCachedSetCount()
+				<< " cached sets, " << m_descriptorAllocator.getCacheHitCount() << " cache hits" << std::endl;
+		}
+
+		if(!m_sceneVariants.empty())
+		{
+			std::cout << "pipeline compiler: " << m_pipelineCompiler.getRequestCount() << " requests, "
+				<< m_pipelineCompiler.getDeduplicatedCount() << " deduplicated, " << m_pipelineCompiler.getCompiledCount() << " compiled in "
+				<< m_pipelineCompiler.getCompileMilliseconds() << " ms of worker time, "
+				<< m_pipelineCompiler.getHitCount() << " hits, " << m_pipelineCompiler.getMissCount() << " misses, "
+				<< m_pipelineCompiler.getFallbackFrameCount() << " fallback frames" << std::endl;
+		}
+
+		m_allocator.printStatistics(std::cout);
+
+		collectBenchmarkResult(cpuFrameTimes, std::chrono::duration<double>(std::chrono::steady_clock::now() - steadyStartTime).count(),
+			m_allocator.getDeviceAllocationCount() - steadyStartAllocations, m_drawCount - steadyStartDraws,
+			m_stagingRing.getBytesUploaded() - steadyStartUploads);
+	}
+
+	/**
+	 * \brief 汇总预热之后的帧的基准测试结果
+	 * \param cpuFrameTimes 每帧drawFrame的耗时
+	 * \param seconds 预热之后经过的时间
+	 * \param allocations 预热之后的vkAllocateMemory次数
+	 * \param draws 预热之后的绘制调用数
+	 * \param uploadBytes 预热之后上传的字节数
+	 */
+	void collectBenchmarkResult(std::vector<double> cpuFrameTimes, double seconds, uint64_t allocations, uint64_t draws, VkDeviceSize uploadBytes)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+		BenchmarkResult result;
+		result.m_scene = sceneName(m_config.m_scene);
+		result.m_deviceName = properties.deviceName;
+		result.m_width = m_swapChainExtent.width;
+		result.m_height = m_swapChainExtent.height;
+		result.m_jobThreads = m_jobs.getThreadCount() - 1;
+		result.m_recordJobs = m_config.m_recordJobs;
+		result.m_frames = cpuFrameTimes.size();
+
+		if (!cpuFrameTimes.empty() && seconds > 0.0)
+		{
+			std::sort(cpuFrameTimes.begin(), cpuFrameTimes.end());
+			double sum = 0.0;
+			for (double time : cpuFrameTimes)
+			{
+				sum += time;
+			}
+
+			double frames = static_cast<double>(cpuFrameTimes.size());
+			result.m_cpuFrameAverage = sum / frames;
+			result.m_cpuFrameP99 = cpuFrameTimes[std::min(cpuFrameTimes.size() - 1, cpuFrameTimes.size() * 99 / 100)];
+			result.m_drawsPerFrame = draws / cpuFrameTimes.size();
+			result.m_drawCallsPerSecond = draws / seconds;
+			result.m_pipelineFallbackFrames = m_pipelineCompiler.getFallbackFrameCount();
+			result.m_allocationsPerFrame = allocations / frames;
+			result.m_uploadBytesPerFrame = uploadBytes / frames;
+			result.m_framesPerSecond = frames / seconds;
+		}
+
+		for (const auto& statistics : m_gpuProfiler.getStatistics())
+		{
+			if (statistics.m_name == "frame")
+			{
+				result.m_gpuFrameAverage = statistics.m_average;
+			}
+		}
+
+		std::cout << "benchmark " << result.m_scene << ": cpu " << result.m_cpuFrameAverage << " ms (p99 " << result.m_cpuFrameP99
+			<< " ms), gpu " << result.m_gpuFrameAverage << " ms, " << result.m_drawCallsPerSecond << " draws/s, "
+			<< result.m_allocationsPerFrame << " allocations/frame" << std::endl;
+
+		m_benchmarkResult = result;
+	}
+
+	/**
+	 * \brief 绘制一帧
+	 */
+	void drawFrame()
+	{
+		CpuTraceScope traceScope("drawFrame");
+
+		FrameData& frame = m_frames[m_currentFrame];
+
+		// 只等待同一槽位上一次提交的帧，CPU可以在GPU执行前面的帧时录制这一帧
+		{
+			CpuTraceScope waitScope("wait frame fence");
+			vkWaitForFences(m_device, 1, &frame.m_inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		}
+
+		// 同一槽位的上一帧已经完成，比它更早的帧也都已经完成
+		uint32_t framesInFlight = static_cast<uint32_t>(m_frames.size());
+		if (m_frameNumber >= framesInFlight)
+		{
+			m_deletionQueue.flush(m_frameNumber - framesInFlight);
+		}
+
+		// 回收这一帧在暂存环形缓冲中的区域，本帧的上传从这里开始录制
+		m_stagingRing.beginFrame(m_currentFrame);
+
+		// 同一槽位的上一帧已经完成，它的临时描述符集整池回收
+		m_descriptorAllocator.beginFrame(m_currentFrame);
+
+		// 交换链已经过期时重建后跳过这一帧，栅栏还没有重置，下一次等待不会阻塞
+		uint32_t imageIndex;
+		if (!acquireNextImage(frame.m_imageAvailableSemaphore, imageIndex))
+		{
+			recreateSwapChain();
+			return;
+		}
+
+		// 图像数量少于飞行帧数时，图像可能仍被另一帧使用
+		if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE && m_imagesInFlight[imageIndex] != frame.m_inFlightFence)
+		{
+			CpuTraceScope waitScope("wait image fence");
+			vkWaitForFences(m_device, 1, &m_imagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		}
+		m_imagesInFlight[imageIndex] = frame.m_inFlightFence;
+
+		vkResetFences(m_device, 1, &frame.m_inFlightFence);
+
+		uploadSceneData();
+
+		// 本帧的所有复制一次提交到传输队列，必须在等待它的图形提交之前
+		VkPipelineStageFlags uploadWaitStages = 0;
+		VkSemaphore uploadSemaphore = m_stagingRing.submit(uploadWaitStages);
+
+		// 整体重置命令池比逐个重置命令缓冲开销更小
+		vkResetCommandPool(m_device, frame.m_commandPool, 0);
+		recordCommandBuffer(frame.m_commandBuffer, imageIndex);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+		std::array<VkSemaphore, 2> waitSemaphores;
+		std::array<VkPipelineStageFlags, 2> waitStages;
+		uint32_t waitCount = 0;
+
+		// 有交换链时，需要等待图像可用，并在渲染完成后通知呈现
+		if (!m_config.m_headless)
+		{
+			waitSemaphores[waitCount] = frame.m_imageAvailableSemaphore;
+			waitStages[waitCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			waitCount++;
+
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &m_renderFinishedSemaphores[imageIndex];
+		}
+
+		// 专用传输队列上的复制完成后才能使用上传的资源
+		if (uploadSemaphore != VK_NULL_HANDLE)
+		{
+			waitSemaphores[waitCount] = uploadSemaphore;
+			waitStages[waitCount] = uploadWaitStages;
+			waitCount++;
+		}
+
+		submitInfo.waitSemaphoreCount = waitCount;
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &frame.m_commandBuffer;
+
+		{
+			CpuTraceScope submitScope("submit");
+			if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, frame.m_inFlightFence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to submit draw command buffer!");
+			}
+		}
+
+		bool swapChainOutdated = !presentImage(imageIndex);
+		if (swapChainOutdated || m_framebufferResized)
+		{
+			m_framebufferResized = false;
+			recreateSwapChain();
+		}
+
+		m_currentFrame = (m_currentFrame + 1) % framesInFlight;
+		m_frameNumber++;
+	}
+
+	/**
+	 * \brief 获取下一帧要渲染的图像
+	 * \param imageAvailableSemaphore 图像可用时触发的信号量
+	 * \param imageIndex 返回交换链或离屏图像环中的图像索引
+	 * \return 交换链已经过期、需要重建时返回false
+	 */
+	bool acquireNextImage(VkSemaphore imageAvailableSemaphore, uint32_t& imageIndex)
+	{
+		CpuTraceScope traceScope("acquire");
+
+		// 离屏图像环按顺序轮转，不受呈现引擎和垂直同步限制
+		if (m_config.m_headless)
+		{
+			imageIndex = m_nextOffscreenImage;
+			m_nextOffscreenImage = (m_nextOffscreenImage + 1) % static_cast<uint32_t>(m_swapChainImages.size());
+			return true;
+		}
+
+		VkResult result = vkAcquireNextImageKHR(m_device, m_swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			return false;
+		}
+
+		// VK_SUBOPTIMAL_KHR时信号量已经触发，继续渲染这一帧，呈现之后再重建
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		{
+			throw std::runtime_error("failed to acquire swap chain image!");
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief 呈现渲染完成的图像，无窗口模式下什么都不做
+	 * \param imageIndex
+	 * \return 交换链已经过期或不再最优、需要重建时返回false
+	 */
+	bool presentImage(uint32_t imageIndex)
+	{
+		CpuTraceScope traceScope("present");
+
+		if (m_config.m_headless)
+		{
+			return true;
+		}
+
+		VkPresentInfoKHR presentInfo = {};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &m_renderFinishedSemaphores[imageIndex];
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &m_swapChain;
+		presentInfo.pImageIndices = &imageIndex;
+
+		VkResult result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+
+		// FIFO模式下呈现调用会被垂直同步阻塞，稳定后相邻两次返回的间隔就是实际的显示间隔
+		auto now = std::chrono::steady_clock::now();
+		if (m_presentCount > 0)
+		{
+			double interval = std::chrono::duration<double, std::milli>(now - m_lastPresentTime).count();
+			m_presentIntervalSum += interval;
+			m_presentIntervalMin = std::min(m_presentIntervalMin, interval);
+			m_presentIntervalMax = std::max(m_presentIntervalMax, interval);
+		}
+		m_lastPresentTime = now;
+		m_presentCount++;
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		{
+			return false;
+		}
+
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to present swap chain image!");
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief 重建交换链及依赖它的对象
+	 *
+	 * 旧交换链通过oldSwapchain交给驱动复用资源，旧的图像视图、帧缓冲、管线等
+	 * 可能仍被飞行中的帧使用，放进延迟删除队列，不需要等待设备空闲。
+	 */
+	void recreateSwapChain()
+	{
+		CpuTraceScope traceScope("recreateSwapChain");
+
+		// 窗口最小化时帧缓冲大小为0，无法创建交换链，等待窗口恢复
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(m_window, &width, &height);
+		while (width == 0 || height == 0)
+		{
+			if (glfwWindowShouldClose(m_window))
+			{
+				return;
+			}
+			glfwWaitEvents();
+			glfwGetFramebufferSize(m_window, &width, &height);
+		}
+
+		VkDevice device = m_device;
+
+		// 这一帧可能已经提交，用当前帧序号退役
+		std::vector<VkFramebuffer> oldFramebuffers = m_swapChainFramebuffers;
+		std::vector<VkImageView> oldImageViews = m_swapChainImageViews;
+		std::vector<VkSemaphore> oldSemaphores = m_renderFinishedSemaphores;
+		m_deletionQueue.push(m_frameNumber, [device, oldFramebuffers, oldImageViews, oldSemaphores]()
+		{
+			for (auto framebuffer : oldFramebuffers)
+			{
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+			for (auto imageView : oldImageViews)
+			{
+				vkDestroyImageView(device, imageView, nullptr);
+			}
+			for (auto semaphore : oldSemaphores)
+			{
+				vkDestroySemaphore(device, semaphore, nullptr);
+			}
+		});
+
+		VkSwapchainKHR oldSwapChain = m_swapChain;
+		VkFormat oldFormat = m_swapChainImageFormat;
+
+		createSwapChain();
+
+		// 旧交换链已经退役，但之前呈现的图像可能还没有显示完
+		m_deletionQueue.push(m_frameNumber, [device, oldSwapChain]()
+		{
+			vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+		});
+
+		createImageViews();
+
+		// 渲染流程只依赖图像格式，格式不变时继续使用。视口和裁剪矩形是动态状态，
+		// 只有渲染流程改变时管线才需要重新创建
+		if (m_swapChainImageFormat != oldFormat)
+		{
+			VkRenderPass oldRenderPass = m_renderPass;
+			std::vector<VkPipeline> oldPipelines;
+
+			// 正在重载的管线使用旧的渲染流程，丢弃之后按新的渲染流程重新开始
+			cancelShaderReload();
+
+			// 还在编译的变体完成后直接销毁，已经完成的管线（包括通用管线）一起退役
+			m_pipelineCompiler.reset([&oldPipelines](VkPipeline pipeline)
+			{
+				oldPipelines.push_back(pipeline);
+			});
+			m_deletionQueue.push(m_frameNumber, [device, oldRenderPass, oldPipelines]()
+			{
+				for (auto pipeline : oldPipelines)
+				{
+					vkDestroyPipeline(device, pipeline, nullptr);
+				}
+				vkDestroyRenderPass(device, oldRenderPass, nullptr);
+			});
+			createRenderPass();
+			createGraphicsPipeline();
+		}
+
+		createFramebuffers();
+		createPresentSemaphores();
+
+		std::cout << "swap chain recreated: " << m_swapChainExtent.width << "x" << m_swapChainExtent.height << ", "
+			<< m_swapChainImages.size() << " images, " << m_deletionQueue.size() << " deletions pending" << std::endl;
+	}
+
+	/**
+	 * \brief 清理工作
+	 */
+	void cleanup()
+	{
+		cancelShaderReload();
+		m_shaderWatcher.destroy();
+
+		// 设备已经空闲，退役的对象可以全部销毁
+		m_deletionQueue.flushAll();
+
+		for(auto& frame : m_frames)
+		{
+			vkDestroySemaphore(m_device, frame.m_imageAvailableSemaphore, nullptr);
+			vkDestroyFence(m_device, frame.m_inFlightFence, nullptr);
+			vkDestroyCommandPool(m_device, frame.m_commandPool, nullptr);
+			for(auto pool : frame.m_secondaryPools)
+			{
+				vkDestroyCommandPool(m_device, pool, nullptr);
+			}
+
+			// 描述符集随描述符分配器的池一起释放
+			if(frame.m_drawDataBuffer != VK_NULL_HANDLE)
+			{
+				vkDestroyBuffer(m_device, frame.m_drawDataBuffer, nullptr);
+				m_allocator.free(frame.m_drawDataMemory);
+			}
+		}
+
+		for(auto semaphore : m_renderFinishedSemaphores)
+		{
+			vkDestroySemaphore(m_device, semaphore, nullptr);
+		}
+
+		for(auto framebuffer : m_swapChainFramebuffers)
+		{
+			vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+		}
+
+		// 等待后台编译完成，编译结果也会写进管线缓存
+		m_pipelineCompiler.destroy();
+		vkDestroyShaderModule(m_device, m_fragShaderModule, nullptr);
+		vkDestroyShaderModule(m_device, m_vertShaderModule, nullptr);
+		m_layoutCache.destroy();
+		if(m_bindless)
+		{
+			m_bindlessTable.destroy();
+		}
+
+		savePipelineCache();
+		vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+		vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+
+		for(auto imageView : m_swapChainImageViews)
+		{
+			vkDestroyImageView(m_device, imageView, nullptr);
+		}
+
+		if (m_config.m_headless)
+		{
+			// 离屏图像由应用自己创建，需要自己销毁
+			for (size_t i = 0; i < m_swapChainImages.size(); i++)
+			{
+				vkDestroyImage(m_device, m_swapChainImages[i], nullptr);
+				m_allocator.free(m_offscreenImageMemory[i]);
+			}
+		}
+		else
+		{
+			vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
+		}
+
+		if(m_materialBuffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(m_device, m_materialBuffer, nullptr);
+			m_allocator.free(m_materialBufferMemory);
+		}
+		vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
+		m_allocator.free(m_indexBufferMemory);
+		vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
+		m_allocator.free(m_vertexBufferMemory);
+		for (size_t i = 0; i < m_dynamicVertexBuffers.size(); i++)
+		{
+			vkDestroyBuffer(m_device, m_dynamicVertexBuffers[i], nullptr);
+			m_allocator.free(m_dynamicVertexBufferMemory[i]);
+		}
+
+		m_stagingRing.destroy();
+		m_descriptorAllocator.destroy();
+		m_gpuProfiler.destroy();
+
+		m_allocator.destroy();
+
+		vkDestroyDevice(m_device, nullptr);
+
+		if (enableValidationLayers)
+		{
+			DestroyDebugUtilsMessengerEXT(m_instance, m_callback, nullptr);
+		}
+
+		if (!m_config.m_headless)
+		{
+			vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+		}
+		vkDestroyInstance(m_instance, nullptr);
+
+		if (!m_config.m_headless)
+		{
+			glfwDestroyWindow(m_window);
+
+			glfwTerminate();
+		}
+	}
+
+	/**
+	 * \brief 创建Vulkan实例
+	 */
+	void createInstance()
+	{
+		CpuTraceScope traceScope("createInstance");
+
+		if (enableValidationLayers && !checkValidationLayerSupport())
+		{
+			throw std::runtime_error("validation layers requested, but not available!");
+		}
+
+		VkApplicationInfo appInfo{};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "Hello Triangle";
+		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.pEngineName = "No Engine";
+		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		// 1.1用于查询设备UUID，1.2的描述符索引用于无绑定模式，只支持较低版本的驱动仍然可以使用
+		appInfo.apiVersion = VK_API_VERSION_1_2;
+
+		VkInstanceCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		createInfo.pApplicationInfo = &appInfo;
+
+		// 检测扩展支持
+		auto extensions = getRequiredExtensions();
+		createInfo.enabledExtensionCount = extensions.size();
+		createInfo.ppEnabledExtensionNames = extensions.data();
+
+		// 在校验层启用时使用校验层
+		if (enableValidationLayers)
+		{
+			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+			createInfo.ppEnabledLayerNames = validationLayers.data();
+		}
+		else
+		{
+			createInfo.enabledLayerCount = 0;
+		}
+
+		if (vkCreateInstance(&createInfo, nullptr, &m_instance) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create instance!");
+		}
+	}
+
+	/**
+	 * \brief 检查校验层
+	 * \return
+	 */
+	bool checkValidationLayerSupport()
+	{
+		uint32_t layerCount;
+		vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+		// 获取所有可用的校验层列表
+		std::vector<VkLayerProperties> availableLayers(layerCount);
+		vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+		// 检查是否存在列表中指定的校验层
+		for (const char* layerName : validationLayers)
+		{
+			bool layerFound = false;
+
+			for (const auto& layerProperties : availableLayers)
+			{
+				if (strcmp(layerName, layerProperties.layerName) == 0)
+				{
+					layerFound = true;
+					break;
+				}
+			}
+
+			if (!layerFound)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief 根据是否启用校验层，返回所需的扩展列表
+	 * \return
+	 */
+	std::vector<const char*> getRequiredExtensions()
+	{
+		std::vector<const char*> extensions;
+
+		// 无窗口模式不需要任何表面扩展
+		if (!m_config.m_headless)
+		{
+			uint32_t glfwExtensionCount = 0;
+
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
+
+		if (enableValidationLayers)
+		{
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		}
+
+		return extensions;
+	}
+
+	/**
+	 * \brief 设置Debug回调
+	 */
+	void setupDebugCallback()
+	{
+		if (!enableValidationLayers)
+		{
+			return;
+		}
+
+		VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+		createInfo.messageSeverity =
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		createInfo.messageType =
+			VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+		createInfo.pfnUserCallback = debugCallback;
+		createInfo.pUserData = nullptr;	// Optional
+
+		if (CreateDebugUtilsMessengerEXT(m_instance, &createInfo, nullptr, &m_callback) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to set up debug callback!");
+		}
+	}
+
+	/**
+	 * \brief 创建窗口表面
+	 */
+	void createSurface()
+	{
+		if (m_config.m_headless)
+		{
+			return;
+		}
+
+		if(glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create window surface!");
+		}
+	}
+
+	/**
+	 * \brief 选择一个物理设备（显卡）
+	 */
+	void pickPhysicalDevice()
+	{
+		CpuTraceScope traceScope("pickPhysicalDevice");
+
+		// 请求显卡的数量
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
+
+		if(deviceCount == 0)
+		{
+			throw std::runtime_error("failed to find GPUs with Vulkan support!");
+		}
+
+		// 分配数组来存储VkPhysicalDevice对象
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
+
+		std::vector<DeviceCandidate> candidates;
+		for(uint32_t i = 0; i < deviceCount; i++)
+		{
+			candidates.push_back(describeDevice(devices[i], i));
+		}
+
+		// 按评分排序，同分时按UUID和名称排序，结果与枚举顺序无关
+		std::sort(candidates.begin(), candidates.end(), [](const DeviceCandidate& a, const DeviceCandidate& b)
+		{
+			if(a.m_suitable != b.m_suitable)
+			{
+				return a.m_suitable;
+			}
+			if(a.m_score != b.m_score)
+			{
+				return a.m_score > b.m_score;
+			}
+			int uuidOrder = memcmp(a.m_uuid, b.m_uuid, VK_UUID_SIZE);
+			if(uuidOrder != 0)
+			{
+				return uuidOrder < 0;
+			}
+			return strcmp(a.m_properties.deviceName, b.m_properties.deviceName) < 0;
+		});
+
+		std::cout << "physical devices:" << std::endl;
+		for(size_t rank = 0; rank < candidates.size(); rank++)
+		{
+			const DeviceCandidate& candidate = candidates[rank];
+			std::cout << "  #" << rank << " [" << candidate.m_index << "] " << candidate.m_properties.deviceName
+				<< " (" << deviceTypeName(candidate.m_properties.deviceType)
+				<< ", " << (candidate.m_deviceLocalBytes >> 20) << " MiB, " << formatUuid(candidate.m_uuid) << ") ";
+			if(candidate.m_suitable)
+			{
+				std::cout << "score " << candidate.m_score << std::endl;
+			}
+			else
+			{
+				std::cout << "unsuitable" << std::endl;
+			}
+		}
+
+		if(!m_config.m_deviceOverride.empty())
+		{
+			// 用户指定的设备，即使评分不是最高也使用它
+			for(const auto& candidate : candidates)
+			{
+				if(matchesDeviceOverride(candidate, m_config.m_deviceOverride))
+				{
+					if(!candidate.m_suitable)
+					{
+						throw std::runtime_error("requested GPU " + std::string(candidate.m_properties.deviceName) + " is not suitable!");
+					}
+					m_physicalDevice = candidate.m_device;
+					break;
+				}
+			}
+
+			if(m_physicalDevice == VK_NULL_HANDLE)
+			{
+				throw std::runtime_error("no GPU matches " + m_config.m_deviceOverride + "!");
+			}
+		}
+		else if(!candidates.empty() && candidates[0].m_suitable)
+		{
+			m_physicalDevice = candidates[0].m_device;
+		}
+
+		if(m_physicalDevice == VK_NULL_HANDLE)
+		{
+			throw std::runtime_error("failed to find a suitable GPU!");
+		}
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+		std::cout << "using " << properties.deviceName << std::endl;
+	}
+
+	/**
+	 * \brief 收集设备信息并评分
+	 * \param device
+	 * \param index 枚举索引
+	 * \return
+	 */
+	DeviceCandidate describeDevice(VkPhysicalDevice device, uint32_t index)
+	{
+		DeviceCandidate candidate;
+		candidate.m_device = device;
+		candidate.m_index = index;
+		vkGetPhysicalDeviceProperties(device, &candidate.m_properties);
+
+		// 设备UUID需要Vulkan 1.1
+		if(candidate.m_properties.apiVersion >= VK_API_VERSION_1_1)
+		{
+			VkPhysicalDeviceIDProperties idProperties = {};
+			idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+			VkPhysicalDeviceProperties2 properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &idProperties;
+
+			vkGetPhysicalDeviceProperties2(device, &properties2);
+			memcpy(candidate.m_uuid, idProperties.deviceUUID, VK_UUID_SIZE);
+		}
+
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(device, &memProperties);
+		for(uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+		{
+			if(memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			{
+				candidate.m_deviceLocalBytes += memProperties.memoryHeaps[i].size;
+			}
+		}
+
+		candidate.m_suitable = isDeviceSuitable(device);
+		if(candidate.m_suitable)
+		{
+			candidate.m_score = rateDeviceSuitability(device, candidate);
+		}
+
+		return candidate;
+	}
+
+	/**
+	 * \brief 为满足需求的设备评分
+	 * \param device
+	 * \param candidate 已收集的设备信息
+	 * \return
+	 */
+	uint64_t rateDeviceSuitability(VkPhysicalDevice device, const DeviceCandidate& candidate)
+	{
+		const VkPhysicalDeviceProperties& properties = candidate.m_properties;
+
+		// 设备类型的权重最大，保证独立显卡总是排在集成显卡和软件光栅器前面
+		uint64_t score = 0;
+		switch(properties.deviceType)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+			score += 1000000;
+			break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+			score += 100000;
+			break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+			score += 10000;
+			break;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:
+			score += 1000;
+			break;
+		default:
+			break;
+		}
+
+		// 同类设备中显存越大越好，每64MiB记1分
+		score += candidate.m_deviceLocalBytes >> 26;
+
+		// 能力限制
+		score += properties.limits.maxImageDimension2D / 1024;
+		score += properties.limits.maxBoundDescriptorSets;
+		score += properties.limits.maxPushConstantsSize / 64;
+
+		// 可选特性
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures(device, &features);
+		VkBool32 optionalFeatures[] = { features.samplerAnisotropy, features.fillModeNonSolid, features.multiDrawIndirect, features.pipelineStatisticsQuery };
+		for(VkBool32 supported : optionalFeatures)
+		{
+			score += supported ? 10 : 0;
+		}
+
+		// 可选扩展
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		for(const char* name : optionalDeviceExtensions)
+		{
+			for(const auto& extension : availableExtensions)
+			{
+				if(strcmp(name, extension.extensionName) == 0)
+				{
+					score += 10;
+					break;
+				}
+			}
+		}
+
+		return score;
+	}
+
+	/**
+	 * \brief 设备是否与用户指定的索引、UUID或名称匹配
+	 * \param candidate
+	 * \param selector
+	 * \return
+	 */
+	static bool matchesDeviceOverride(const DeviceCandidate& candidate, const std::string& selector)
+	{
+		// 不超过3位的纯数字视为枚举索引，更长的数字可能是UUID或名称的一部分，继续按下面的规则匹配
+		if(!selector.empty() && selector.size() <= 3 &&
+			std::all_of(selector.begin(), selector.end(), [](char c) { return c >= '0' && c <= '9'; }))
+		{
+			return static_cast<uint32_t>(std::stoul(selector)) == candidate.m_index;
+		}
+
+		auto toLower = [](std::string text)
+		{
+			std::transform(text.begin(), text.end(), text.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+			return text;
+		};
+
+		std::string lowerSelector = toLower(selector);
+
+		// 完整的UUID，允许省略连字符
+		std::string uuid = formatUuid(candidate.m_uuid);
+		std::string compactUuid;
+		std::copy_if(uuid.begin(), uuid.end(), std::back_inserter(compactUuid), [](char c) { return c != '-'; });
+		if(lowerSelector == uuid || lowerSelector == compactUuid)
+		{
+			return true;
+		}
+
+		// 名称的一部分，不区分大小写
+		return toLower(candidate.m_properties.deviceName).find(lowerSelector) != std::string::npos;
+	}
+
+	/**
+	 * \brief 设备类型的可读名称
+	 * \param type
+	 * \return
+	 */
+	static const char* deviceTypeName(VkPhysicalDeviceType type)
+	{
+		switch(type)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+			return "discrete";
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+			return "integrated";
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+			return "virtual";
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:
+			return "cpu";
+		default:
+			return "other";
+		}
+	}
+
+	/**
+	 * \brief 创建逻辑设备
+	 */
+	void createLogicalDevice()
+	{
+		CpuTraceScope traceScope("createLogicalDevice");
+
+		QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
+
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		std::set<int> uniqueQueueFamilies = { indices.m_graphicsFamily, indices.m_presentFamily, indices.m_transferFamily, indices.m_computeFamily };
+
+		float queuePriority = 1.0f;
+		for(int queueFamily : uniqueQueueFamilies)
+		{
+			// 指定要创建的队列
+			VkDeviceQueueCreateInfo queueCreateInfo = {};
+			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueCreateInfo.queueFamilyIndex = queueFamily;
+			queueCreateInfo.queueCount = 1;
+			queueCreateInfo.pQueuePriorities = &queuePriority;
+			queueCreateInfos.push_back(queueCreateInfo);
+
+		}
+
+		// 指定使用的设备特性
+		VkPhysicalDeviceFeatures deviceFeatures = {};
+
+		std::vector<const char*> extensions = getRequiredDeviceExtensions();
+
+		// 扩展动态状态是可选的，不支持时这些状态仍然固定在管线中
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {};
+		extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+		m_extendedDynamicState = m_config.m_extendedDynamicState && isExtendedDynamicStateSupported(m_physicalDevice);
+		if(m_extendedDynamicState)
+		{
+			extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+			extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+		}
+
+		// 无绑定模式需要的描述符索引特性，1.2之前通过扩展提供
+		VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures = {};
+		descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+		m_bindless = m_config.m_bindless && isDescriptorIndexingSupported(m_physicalDevice);
+		if(m_bindless)
+		{
+			descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+			descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+			descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+			descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+			if(properties.apiVersion < VK_API_VERSION_1_2)
+			{
+				extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			}
+		}
+
+		// 可选特性的结构体串成pNext链
+		void* featureChain = nullptr;
+		if(m_extendedDynamicState)
+		{
+			extendedDynamicStateFeatures.pNext = featureChain;
+			featureChain = &extendedDynamicStateFeatures;
+		}
+		if(m_bindless)
+		{
+			descriptorIndexingFeatures.pNext = featureChain;
+			featureChain = &descriptorIndexingFeatures;
+		}
+
+		// 创建逻辑设备
+		VkDeviceCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+		createInfo.pQueueCreateInfos = queueCreateInfos.data();
+
+		createInfo.pEnabledFeatures = &deviceFeatures;
+		createInfo.pNext = featureChain;
+
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
+
+		if(enableValidationLayers)
+		{
+			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+			createInfo.ppEnabledLayerNames = validationLayers.data();
+		}
+		else
+		{
+			createInfo.enabledLayerCount = 0;
+		}
+
+		if(vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create logical device!");
+		}
+
+		if(m_extendedDynamicState)
+		{
+			m_vkCmdSetCullModeEXT = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetCullModeEXT");
+			m_vkCmdSetFrontFaceEXT = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetFrontFaceEXT");
+			m_vkCmdSetPrimitiveTopologyEXT = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetPrimitiveTopologyEXT");
+			m_vkCmdSetDepthTestEnableEXT = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetDepthTestEnableEXT");
+			m_vkCmdSetDepthWriteEnableEXT = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetDepthWriteEnableEXT");
+			m_vkCmdSetDepthCompareOpEXT = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetDepthCompareOpEXT");
+		}
+
+		// 获取队列句柄
+		vkGetDeviceQueue(m_device, indices.m_graphicsFamily, 0, &m_graphicsQueue);
+		vkGetDeviceQueue(m_device, indices.m_presentFamily, 0, &m_presentQueue);
+		vkGetDeviceQueue(m_device, indices.m_transferFamily, 0, &m_transferQueue);
+		vkGetDeviceQueue(m_device, indices.m_computeFamily, 0, &m_computeQueue);
+
+		m_queueFamilies = indices;
+
+		std::cout << "queue families: graphics " << indices.m_graphicsFamily
+			<< ", present " << indices.m_presentFamily
+			<< ", transfer " << indices.m_transferFamily << (indices.hasDedicatedTransfer() ? " (dedicated)" : " (shared)")
+			<< ", compute " << indices.m_computeFamily << (indices.hasDedicatedCompute() ? " (dedicated)" : " (shared)") << std::endl;
+		std::cout << "extended dynamic state: " << (m_extendedDynamicState ? "enabled" : "disabled") << std::endl;
+		if(m_config.m_bindless)
+		{
+			std::cout << "bindless descriptors: " << (m_bindless ? "enabled" : "not supported by the device") << std::endl;
+		}
+	}
+
+	/**
+	 * \brief 检查设备是否支持无绑定模式需要的描述符索引特性
+	 * \param device
+	 * \return
+	 */
+	bool isDescriptorIndexingSupported(VkPhysicalDevice device)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(device, &properties);
+
+		// 1.2中是核心功能，1.1上需要扩展，查询特性需要1.1的vkGetPhysicalDeviceFeatures2
+		if(properties.apiVersion < VK_API_VERSION_1_1)
+		{
+			return false;
+		}
+		if(properties.apiVersion < VK_API_VERSION_1_2)
+		{
+			uint32_t extensionCount;
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+			std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+			bool extensionSupported = false;
+			for(const auto& extension : availableExtensions)
+			{
+				if(strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0)
+				{
+					extensionSupported = true;
+				}
+			}
+			if(!extensionSupported)
+			{
+				return false;
+			}
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures = {};
+		descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &descriptorIndexingFeatures;
+		vkGetPhysicalDeviceFeatures2(device, &features2);
+
+		return descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE &&
+			descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing == VK_TRUE &&
+			descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+			descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+			descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+			descriptorIndexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+			descriptorIndexingFeatures.runtimeDescriptorArray == VK_TRUE;
+	}
+
+	/**
+	 * \brief 创建无绑定描述符表，并把它的布局保留为所有管线布局的集合0
+	 */
+	void createBindlessTable()
+	{
+		if(!m_bindless)
+		{
+			return;
+		}
+
+		// 数组大小受绑定后更新的限制，组合图像采样器同时计入图像和采样器
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+
+		uint32_t imageCapacity = std::min({ BINDLESS_IMAGE_CAPACITY,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+		uint32_t bufferCapacity = std::min({ BINDLESS_BUFFER_CAPACITY,
+			indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+		// 两个数组都对所有阶段可见，每个阶段的资源总数也有上限
+		uint32_t perStageResources = indexingProperties.maxPerStageUpdateAfterBindResources;
+		if(imageCapacity + bufferCapacity > perStageResources)
+		{
+			imageCapacity = std::min(imageCapacity, perStageResources / 2);
+			bufferCapacity = std::min(bufferCapacity, perStageResources - imageCapacity);
+		}
+
+		m_bindlessTable.init(m_device, imageCapacity, bufferCapacity);
+		m_layoutCache.reserveSet(BINDLESS_SET, m_bindlessTable.getLayout());
+
+		std::cout << "bindless table: " << imageCapacity << " image slots, " << bufferCapacity << " buffer slots" << std::endl;
+	}
+
+	/**
+	 * \brief 设备是否支持VK_EXT_extended_dynamic_state扩展及其特性
+	 * \param device
+	 * \return
+	 */
+	bool isExtendedDynamicStateSupported(VkPhysicalDevice device)
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		bool extensionSupported = false;
+		for(const auto& extension : availableExtensions)
+		{
+			if(strcmp(extension.extensionName, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) == 0)
+			{
+				extensionSupported = true;
+			}
+		}
+
+		// 查询特性需要Vulkan 1.1的vkGetPhysicalDeviceFeatures2
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(device, &properties);
+		if(!extensionSupported || properties.apiVersion < VK_API_VERSION_1_1)
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {};
+		extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &extendedDynamicStateFeatures;
+		vkGetPhysicalDeviceFeatures2(device, &features2);
+
+		return extendedDynamicStateFeatures.extendedDynamicState == VK_TRUE;
+	}
+
+	/**
+	 * \brief 创建管线缓存，如果磁盘上有匹配当前设备的缓存则用它初始化
+	 * \param initialData loadPipelineCacheData读到的缓存数据，为空时从空缓存开始
+	 */
+	void createPipelineCache(std::vector<char> initialData)
+	{
+		VkPipelineCacheCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = initialData.size();
+		createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+		VkResult result = vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache);
+		if(result != VK_SUCCESS && !initialData.empty())
+		{
+			// 驱动拒绝了缓存数据，退回到空缓存
+			std::cerr << "pipeline cache rejected by driver, starting cold" << std::endl;
+			initialData.clear();
+			createInfo.initialDataSize = 0;
+			createInfo.pInitialData = nullptr;
+			result = vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache);
+		}
+
+		if(result != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline cache!");
+		}
+
+		m_pipelineCacheWarm = !initialData.empty();
+	}
+
+	/**
+	 * \brief 读取并校验磁盘上的管线缓存，任何不匹配都返回空数据
+	 * \return 可以直接交给vkCreatePipelineCache的缓存数据
+	 */
+	std::vector<char> loadPipelineCacheData()
+	{
+		if(m_config.m_pipelineCachePath.empty())
+		{
+			return {};
+		}
+
+		std::ifstream file(m_config.m_pipelineCachePath, std::ios::ate | std::ios::binary);
+		if(!file.is_open())
+		{
+			return {};
+		}
+
+		size_t fileSize = (size_t)file.tellg();
+		file.seekg(0);
+
+		auto discard = [&](const char* reason)
+		{
+			std::cerr << "discarding pipeline cache " << m_config.m_pipelineCachePath << ": " << reason << std::endl;
+			return std::vector<char>();
+		};
+
+		PipelineCacheFileHeader header = {};
+		if(fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		{
+			return discard("truncated header");
+		}
+
+		if(header.m_magic != PIPELINE_CACHE_MAGIC || header.m_headerSize != sizeof(header))
+		{
+			return discard("unknown format");
+		}
+
+		// 缓存只对生成它的设备和驱动有效
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+		if(header.m_vendorID != properties.vendorID || header.m_deviceID != properties.deviceID ||
+			header.m_driverVersion != properties.driverVersion ||
+			memcmp(header.m_pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			return discard("device or driver changed");
+		}
+
+		if(header.m_dataSize != fileSize - sizeof(header))
+		{
+			return discard("size mismatch");
+		}
+
+		std::vector<char> data(static_cast<size_t>(header.m_dataSize));
+		if(!file.read(data.data(), data.size()) || hashBytes(data.data(), data.size()) != header.m_dataHash)
+		{
+			return discard("checksum mismatch");
+		}
+
+		return data;
+	}
+
+	/**
+	 * \brief 把管线缓存写回磁盘，先写临时文件再替换，避免留下写了一半的文件
+	 */
+	void savePipelineCache()
+	{
+		if(m_config.m_pipelineCachePath.empty() || m_pipelineCache == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		size_t dataSize = 0;
+		if(vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		{
+			return;
+		}
+
+		std::vector<char> data(dataSize);
+		if(vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+		{
+			return;
+		}
+		data.resize(dataSize);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+		PipelineCacheFileHeader header = {};
+		header.m_magic = PIPELINE_CACHE_MAGIC;
+		header.m_headerSize = sizeof(header);
+		header.m_vendorID = properties.vendorID;
+		header.m_deviceID = properties.deviceID;
+		header.m_driverVersion = properties.driverVersion;
+		memcpy(header.m_pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+		header.m_dataSize = data.size();
+		header.m_dataHash = hashBytes(data.data(), data.size());
+
+		std::string tempPath = m_config.m_pipelineCachePath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if(!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(data.data(), data.size()))
+			{
+				std::cerr << "failed to write pipeline cache " << tempPath << std::endl;
+				return;
+			}
+		}
+
+		// Windows上rename不会覆盖已有文件
+		std::remove(m_config.m_pipelineCachePath.c_str());
+		if(std::rename(tempPath.c_str(), m_config.m_pipelineCachePath.c_str()) != 0)
+		{
+			std::cerr << "failed to replace pipeline cache " << m_config.m_pipelineCachePath << std::endl;
+		}
+	}
+
+	/**
+	 * \brief 创建交换链
+	 */
+	void createSwapChain()
+	{
+		CpuTraceScope traceScope("createSwapChain");
+
+		if(m_config.m_headless)
+		{
+			createOffscreenImages();
+			return;
+		}
+
+		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_physicalDevice);
+
+		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.m_formats);
+		VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.m_presentModes);
+		VkExtent2D extent = chooseSwapExtent(swapChainSupport.m_capabilities);
+
+		// 设置交换链队列可以容纳的图像个数，由配置档决定在最少图像数之上多要几张
+		PresentPolicy policy = getPresentPolicy(m_config.m_presentProfile);
+		uint32_t imageCount = swapChainSupport.m_capabilities.minImageCount + policy.m_extraImages;
+		// maxImageCount的值为0表明，只要内存满足，可以使用任意数量的图像
+		if(swapChainSupport.m_capabilities.maxImageCount > 0 &&  imageCount > swapChainSupport.m_capabilities.maxImageCount)
+		{
+			imageCount = swapChainSupport.m_capabilities.maxImageCount;
+		}
+		uint32_t requestedImageCount = imageCount;
+
+		VkSwapchainCreateInfoKHR createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+		createInfo.surface = m_surface;
+
+		createInfo.minImageCount = imageCount;
+		createInfo.imageFormat = surfaceFormat.format;
+		createInfo.imageColorSpace = surfaceFormat.colorSpace;
+		createInfo.imageExtent = extent;
+		createInfo.imageArrayLayers = 1;
+		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+		QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
+		uint32_t queueFamilyIndices[] = { (uint32_t)indices.m_graphicsFamily, (uint32_t)indices.m_presentFamily };
+
+		if(indices.m_graphicsFamily != indices.m_presentFamily)
+		{
+			createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+			createInfo.queueFamilyIndexCount = 2;
+			createInfo.pQueueFamilyIndices = queueFamilyIndices;
+		}
+		else
+		{
+			createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			createInfo.queueFamilyIndexCount = 0;	// Optional
+			createInfo.pQueueFamilyIndices = nullptr;	// Optional
+		}
+
+		createInfo.preTransform = swapChainSupport.m_capabilities.currentTransform;
+		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+		createInfo.presentMode = presentMode;
+		createInfo.clipped = VK_TRUE;
+
+		// 重建时把旧交换链交给驱动，可以复用其中的资源，旧交换链由调用者负责销毁
+		createInfo.oldSwapchain = m_swapChain;
+
+		if(vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create swap chain!");
+		}
+
+		vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, nullptr);
+		m_swapChainImages.resize(imageCount);
+		vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, m_swapChainImages.data());
+
+		m_swapChainImageFormat = surfaceFormat.format;
+		m_swapChainExtent = extent;
+		m_presentMode = presentMode;
+
+		std::cout << "present profile " << policy.m_name << ": " << presentModeName(presentMode) << ", "
+			<< imageCount << " images (requested " << requestedImageCount << ", surface minimum " << swapChainSupport.m_capabilities.minImageCount << "), "
+			<< m_config.m_framesInFlight << " frames in flight" << std::endl;
+	}
+
+	/**
+	 * \brief 创建离屏图像环，在无窗口模式下代替交换链图像
+	 */
+	void createOffscreenImages()
+	{
+		// R8G8B8A8_UNORM作为颜色附件是所有实现都必须支持的格式
+		m_swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		m_swapChainExtent = { m_config.m_width, m_config.m_height };
+
+		m_swapChainImages.resize(m_config.m_offscreenImageCount);
+		m_offscreenImageMemory.resize(m_config.m_offscreenImageCount);
+
+		for(uint32_t i = 0; i < m_config.m_offscreenImageCount; i++)
+		{
+			createImage(m_swapChainExtent.width, m_swapChainExtent.height, m_swapChainImageFormat,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_swapChainImages[i], m_offscreenImageMemory[i]);
+		}
+	}
+
+	/**
+	 * \brief 创建2D图像并从子分配器为其分配绑定内存
+	 * \param width
+	 * \param height
+	 * \param format
+	 * \param usage
+	 * \param properties 内存属性
+	 * \param image
+	 * \param imageMemory
+	 */
+	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage,
+		VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory)
+	{
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = width;
+		imageInfo.extent.height = height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = usage;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if(vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create image!");
+		}
+
+		// 渲染目标这类大图像会按驱动的建议走独占分配
+		imageMemory = m_allocator.allocateForImage(image, properties, imageInfo.tiling);
+	}
+
+	/**
+	 * \brief 创建图像视图
+	 */
+	void createImageViews()
+	{
+		// 分配空间类存储图像视图
+		m_swapChainImageViews.resize(m_swapChainImages.size());
+
+		// 遍历所有交换链图像，创建图像视图
+		for(size_t i = 0; i < m_swapChainImages.size(); i++)
+		{
+			VkImageViewCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			createInfo.image = m_swapChainImages[i];
+
+			// 指定图像数据的解释方式
+			createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			createInfo.format = m_swapChainImageFormat;
+
+			// 指定图像颜色通道的映射
+			createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+			// 指定图像的用途和图像的哪一部分可以被访问
+			createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			createInfo.subresourceRange.baseMipLevel = 0;
+			createInfo.subresourceRange.levelCount = 1;
+			createInfo.subresourceRange.baseArrayLayer = 0;
+			createInfo.subresourceRange.layerCount = 1;
+
+			// 创建图像视图
+			if(vkCreateImageView(m_device, &createInfo, nullptr, &m_swapChainImageViews[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create image views!");
+			}
+		}
+	}
+
+	/**
+	 * \brief 创建渲染流程
+	 */
+	void createRenderPass()
+	{
+		VkAttachmentDescription colorAttachment = {};
+		colorAttachment.format = m_swapChainImageFormat;
+		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// 交换链图像用于呈现，离屏图像保留为可回读的传输源
+		colorAttachment.finalLayout = m_config.m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		VkAttachmentReference colorAttachmentRef = {};
+		colorAttachmentRef.attachment = 0;
+		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorAttachmentRef;
+
+		// 等待图像获取完成后再写入颜色附件
+		VkSubpassDependency dependency = {};
+		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependency.dstSubpass = 0;
+		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependency.srcAccessMask = 0;
+		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &colorAttachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 1;
+		renderPassInfo.pDependencies = &dependency;
+
+		if(vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create render pass!");
+		}
+	}
+
+	/**
+	 * \brief 创建图形管线
+	 */
+	void createGraphicsPipeline()
+	{
+		CpuTraceScope traceScope("createGraphicsPipeline");
+
+		// 后台编译可能还在使用着色器模块，只在第一次创建，退出时销毁
+		if(m_vertShaderModule == VK_NULL_HANDLE)
+		{
+			// 直接把映射的文件交给驱动，省去一次分配和一次完整拷贝
+			MappedFile vertShaderCode(getVertexShaderPath());
+			MappedFile fragShaderCode("shaders/frag.spv");
+
+			m_vertShaderModule = createShaderModule(vertShaderCode.data(), vertShaderCode.size());
+			m_fragShaderModule = createShaderModule(fragShaderCode.data(), fragShaderCode.size());
+			m_vertShaderHash = hashBytes(vertShaderCode.data(), vertShaderCode.size());
+			m_fragShaderHash = hashBytes(fragShaderCode.data(), fragShaderCode.size());
+			m_vertReflection = reflectShader(vertShaderCode.data(), vertShaderCode.size());
+			m_fragReflection = reflectShader(fragShaderCode.data(), fragShaderCode.size());
+		}
+
+		GraphicsPipelineState state = getGraphicsPipelineState();
+		m_pipelineLayout = state.m_layout;
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		// 通用管线同步创建，第一帧就要用到，也是其他管线编译完成之前的替代
+		m_graphicsPipeline = m_pipelineCompiler.compile(state);
+		m_graphicsPipelineState = state;
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		std::cout << "graphics pipeline created in " << milliseconds << " ms ("
+			<< (m_pipelineCacheWarm ? "warm" : "cold") << " pipeline cache, shader variants "
+			<< m_config.m_vertexVariant << "/" << m_config.m_fragmentVariant << ")" << std::endl;
+
+		requestSceneVariants(state);
+	}
+
+	/**
+	 * \brief 按当前的着色器模块、变体清单和渲染流程填写通用管线的状态
+	 * \return
+	 */
+	GraphicsPipelineState getGraphicsPipelineState()
+	{
+		GraphicsPipelineState state;
+		state.m_vertexShader = m_vertShaderModule;
+		state.m_fragmentShader = m_fragShaderModule;
+		state.m_vertexShaderHash = m_vertShaderHash;
+		state.m_fragmentShaderHash = m_fragShaderHash;
+
+		// 功能开关和循环次数通过特化常量传入，所有变体共用同一份SPIR-V
+		ShaderVariantManifest manifest;
+		if(!m_config.m_shaderVariantsPath.empty())
+		{
+			manifest.load(m_config.m_shaderVariantsPath);
+		}
+		state.m_vertexSpecialization = manifest.get("shader.vert", m_config.m_vertexVariant);
+		state.m_fragmentSpecialization = manifest.get("shader.frag", m_config.m_fragmentVariant);
+		state.m_extendedDynamicState = m_extendedDynamicState;
+		state.m_colorFormat = m_swapChainImageFormat;
+		state.m_renderPass = m_renderPass;
+		applyShaderInterface(state, m_vertReflection, m_fragReflection);
+		return state;
+	}
+
+	/**
+	 * \brief 按着色器反射填写顶点输入和管线布局，可以在任务线程上调用
+	 * \param state
+	 * \param vertReflection
+	 * \param fragReflection
+	 */
+	void applyShaderInterface(GraphicsPipelineState& state, const ShaderReflection& vertReflection, const ShaderReflection& fragReflection)
+	{
+		ShaderReflection vertInterface = vertReflection;
+		applyDrawDataInterface(vertInterface);
+
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = buildVertexInput(vertInterface, 0, state.m_vertexAttributes);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		if(bindingDescription.stride != sizeof(Vertex))
+		{
+			throw std::runtime_error("vertex shader inputs do not match Vertex!");
+		}
+		state.m_vertexBindings.assign(1, bindingDescription);
+
+		// 布局相同的着色器得到同一个管线布局，已经绑定的描述符集在切换管线后仍然兼容
+		state.m_layout = m_layoutCache.getPipelineLayout({ &vertInterface, &fragReflection });
+	}
+
+	/**
+	 * \brief 检查顶点着色器中每个绘制的数据与DrawData一致，并把它的uniform缓冲改为动态缓冲
+	 * \param vertReflection
+	 */
+	void applyDrawDataInterface(ShaderReflection& vertReflection) const
+	{
+		if(m_drawDataPushConstants)
+		{
+			if(vertReflection.m_pushConstantOffset != 0 || vertReflection.m_pushConstantSize != sizeof(DrawData))
+			{
+				throw std::runtime_error("vertex shader push constants do not match DrawData!");
+			}
+			return;
+		}
+
+		// 反射无法区分普通和动态的uniform缓冲，绘制数据的缓冲在录制时按偏移选择槽位
+		for(auto& descriptor : vertReflection.m_descriptorBindings)
+		{
+			if(descriptor.m_set == DRAW_DATA_SET && descriptor.m_binding == DRAW_DATA_BINDING &&
+				descriptor.m_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && descriptor.m_count == 1)
+			{
+				descriptor.m_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+				return;
+			}
+		}
+		throw std::runtime_error("vertex shader does not read DrawData from a uniform buffer!");
+	}
+
+	/**
+	 * \brief 顶点着色器的SPIR-V路径，两种传入绘制数据的方式和是否读取无绑定材质各有一份
+	 * \return
+	 */
+	const char* getVertexShaderPath() const
+	{
+		if(m_bindless)
+		{
+			return m_drawDataPushConstants ? "shaders/vert_bindless.spv" : "shaders/vert_ubo_bindless.spv";
+		}
+		return m_drawDataPushConstants ? "shaders/vert.spv" : "shaders/vert_ubo.spv";
+	}
+
+	/**
+	 * \brief 按设备的推送常量限制选择每个绘制的数据的传入方式
+	 */
+	void selectDrawDataPath()
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+		// 规范保证至少128字节，较大的绘制数据或者较小的限制时退回动态uniform缓冲
+		uint32_t pushConstantsLimit = properties.limits.maxPushConstantsSize;
+		m_drawDataPushConstants = !m_config.m_drawDataUniformBuffer && sizeof(DrawData) <= pushConstantsLimit;
+
+		VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+		m_drawDataStride = (sizeof(DrawData) + alignment - 1) / alignment * alignment;
+
+		std::cout << "per-draw data: " << sizeof(DrawData) << " bytes in "
+			<< (m_drawDataPushConstants ? "push constants" : "a dynamic uniform buffer")
+			<< " (maxPushConstantsSize " << pushConstantsLimit << ")" << std::endl;
+	}
+
+	/**
+	 * \brief 不使用推送常量时为每个飞行中的帧创建绘制数据的缓冲和描述符集
+	 */
+	void createDrawDataBuffers()
+	{
+		if(m_drawDataPushConstants)
+		{
+			return;
+		}
+
+		// 与反射生成的管线布局使用同一个缓存的集合布局
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = DRAW_DATA_BINDING;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		VkDescriptorSetLayout setLayout = m_layoutCache.getDescriptorSetLayout({ binding });
+
+		VkDeviceSize bufferSize = m_drawDataStride * getSceneDrawCount();
+		for(auto& frame : m_frames)
+		{
+			createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.m_drawDataBuffer, frame.m_drawDataMemory);
+			if(frame.m_drawDataMemory.m_mapped == nullptr)
+			{
+				throw std::runtime_error("failed to map draw data buffer!");
+			}
+
+			// 描述符只覆盖一个槽位，录制时用动态偏移选择绘制
+			DescriptorSetContents contents;
+			contents.bindBuffer(DRAW_DATA_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frame.m_drawDataBuffer, 0, sizeof(DrawData));
+			frame.m_drawDataSet = m_descriptorAllocator.getCached(setLayout, contents);
+		}
+	}
+
+	/**
+	 * \brief 一次绘制的数据，只读取应用状态，可以在多个线程上同时调用
+	 * \param drawIndex
+	 * \return
+	 */
+	DrawData getDrawData(uint32_t drawIndex) const
+	{
+		DrawData drawData;
+		drawData.m_transform = glm::mat4(1.0f);
+		drawData.m_materialIndex = m_bindless ? m_materialHandles[drawIndex % MATERIAL_COUNT] : drawIndex;
+		return drawData;
+	}
+
+	/**
+	 * \brief 按场景请求通用管线的各个变体
+	 * \param state 通用管线的状态
+	 */
+	void requestSceneVariants(const GraphicsPipelineState& state)
+	{
+		// 多管线场景的变体只有剔除方式、正面朝向和颜色写掩码不同，在任务线程上编译，
+		// 状态相同的变体共用一条管线，开启扩展动态状态时只有颜色写掩码会产生不同的管线
+		m_sceneVariants.clear();
+		if(m_config.m_scene == Scene::ManyPipelines)
+		{
+			for(uint32_t i = 0; i < MANY_PIPELINES_COUNT; i++)
+			{
+				GraphicsPipelineState variantState = state;
+				variantState.m_cullMode = (i & 1) ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+				variantState.m_frontFace = (i & 2) ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
+				variantState.m_colorWriteMask = (i >> 2) & 0xF;
+
+				SceneVariant variant;
+				variant.m_pipeline = m_pipelineCompiler.request(variantState);
+				variant.m_cullMode = variantState.m_cullMode;
+				variant.m_frontFace = variantState.m_frontFace;
+				m_sceneVariants.push_back(variant);
+			}
+			std::cout << m_sceneVariants.size() << " pipeline variants requested, "
+				<< m_pipelineCompiler.getPipelineCount() << " unique pipelines" << std::endl;
+		}
+	}
+
+	/**
+	 * \brief 开始监视SPIR-V、变体清单和着色器源文件
+	 */
+	void createShaderWatcher()
+	{
+		m_shaderWatcher.watch(getVertexShaderPath());
+		m_shaderWatcher.watch("shaders/frag.spv");
+		if(!m_config.m_shaderVariantsPath.empty())
+		{
+			m_shaderWatcher.watch(m_config.m_shaderVariantsPath);
+		}
+		if(!m_config.m_shaderSourceDirectory.empty())
+		{
+			m_shaderWatcher.watch(m_config.m_shaderSourceDirectory + "/shader.vert");
+			m_shaderWatcher.watch(m_config.m_shaderSourceDirectory + "/shader.frag");
+		}
+
+		std::cout << "watching shaders for changes"
+			<< (m_config.m_shaderSourceDirectory.empty() ? "" : " in " + m_config.m_shaderSourceDirectory) << std::endl;
+	}
+
+	/**
+	 * \brief 每帧开始前调用：收集文件修改，启动后台重载，换上已经准备好的管线
+	 */
+	void updateShaderReload()
+	{
+		if(m_shaderWatcher.empty())
+		{
+			return;
+		}
+
+		for(const auto& path : m_shaderWatcher.poll())
+		{
+			if(!m_shaderReloadPending)
+			{
+				m_shaderReloadPending = true;
+				m_shaderChangeTime = std::chrono::steady_clock::now();
+			}
+
+			// 源文件先编译成SPIR-V，写出的SPIR-V会再触发一次重载，内容相同时被忽略
+			if(isShaderSource(path) &&
+				std::find(m_changedShaderSources.begin(), m_changedShaderSources.end(), path) == m_changedShaderSources.end())
+			{
+				m_changedShaderSources.push_back(path);
+			}
+		}
+
+		if(m_shaderReloadInFlight)
+		{
+			// 没有后台线程时任务只会在等待中执行
+			if(m_jobs.getThreadCount() > 1 && !m_shaderReloadJob.isDone())
+			{
+				return;
+			}
+			m_jobs.wait(m_shaderReloadJob);
+			m_shaderReloadInFlight = false;
+			applyShaderReload();
+		}
+
+		if(m_shaderReloadPending)
+		{
+			startShaderReload();
+		}
+	}
+
+	/**
+	 * \brief 判断监视的文件是不是着色器源文件
+	 * \param path
+	 * \return
+	 */
+	static bool isShaderSource(const std::string& path)
+	{
+		size_t dot = path.find_last_of('.');
+		std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+		return extension == "vert" || extension == "frag";
+	}
+
+	/**
+	 * \brief 在任务线程上编译修改过的源文件、创建新的着色器模块和通用管线
+	 */
+	void startShaderReload()
+	{
+		m_shaderReloadPending = false;
+		m_shaderReload = ShaderReload();
+
+		// 变体清单在主线程上读取，格式错误时保留当前的管线
+		try
+		{
+			m_shaderReload.m_state = getGraphicsPipelineState();
+		}
+		catch(const std::exception& e)
+		{
+			std::cerr << "shader reload failed: " << e.what() << std::endl;
+			return;
+		}
+
+		std::vector<std::string> sources;
+		sources.swap(m_changedShaderSources);
+
+		m_shaderReloadInFlight = true;
+		m_jobs.run([this, sources]()
+		{
+			CpuTraceScope traceScope("reload shaders");
+			prepareShaderReload(sources);
+		}, &m_shaderReloadJob);
+	}
+
+	/**
+	 * \brief 重载任务的主体，在任务线程上执行，错误记录在结果中而不抛出
+	 * \param sources 需要先编译的源文件
+	 */
+	void prepareShaderReload(const std::vector<std::string>& sources)
+	{
+		ShaderReload& reload = m_shaderReload;
+		try
+		{
+			for(const auto& source : sources)
+			{
+				compileShaderSource(source);
+			}
+
+			MappedFile vertShaderCode(getVertexShaderPath());
+			MappedFile fragShaderCode("shaders/frag.spv");
+			reload.m_state.m_vertexShaderHash = hashBytes(vertShaderCode.data(), vertShaderCode.size());
+			reload.m_state.m_fragmentShaderHash = hashBytes(fragShaderCode.data(), fragShaderCode.size());
+
+			// 接口改变时换用对应的管线布局，旧布局留在缓存里，正在使用它的管线不受影响
+			reload.m_vertReflection = reflectShader(vertShaderCode.data(), vertShaderCode.size());
+			reload.m_fragReflection = reflectShader(fragShaderCode.data(), fragShaderCode.size());
+			applyShaderInterface(reload.m_state, reload.m_vertReflection, reload.m_fragReflection);
+
+			// 保存了内容相同的文件，或者是编译源文件写出的SPIR-V再次触发
+			if(reload.m_state == m_graphicsPipelineState)
+			{
+				return;
+			}
+
+			reload.m_vertShaderModule = createShaderModule(vertShaderCode.data(), vertShaderCode.size());
+			reload.m_fragShaderModule = createShaderModule(fragShaderCode.data(), fragShaderCode.size());
+			reload.m_state.m_vertexShader = reload.m_vertShaderModule;
+			reload.m_state.m_fragmentShader = reload.m_fragShaderModule;
+			reload.m_pipeline = buildGraphicsPipeline(m_device, m_pipelineCache, reload.m_state);
+		}
+		catch(const std::exception& e)
+		{
+			destroyShaderReload();
+			reload.m_error = e.what();
+		}
+	}
+
+	/**
+	 * \brief 调用glslangValidator把源文件编译到shaders目录，shader.vert输出为getVertexShaderPath，
+	 *        不使用推送常量时定义DRAW_DATA_UNIFORM_BUFFER，无绑定模式下定义BINDLESS
+	 * \param source
+	 */
+	void compileShaderSource(const std::string& source) const
+	{
+		// 查找顺序与compile.sh相同
+		std::string compiler = getEnvironmentVariable("GLSLANG_VALIDATOR");
+		if(compiler.empty())
+		{
+			std::string sdk = getEnvironmentVariable("VULKAN_SDK");
+			compiler = sdk.empty() ? "glslangValidator" : sdk + "/bin/glslangValidator";
+		}
+
+		std::string stage = source.substr(source.find_last_of('.') + 1);
+		std::string output = "shaders/" + stage + ".spv";
+		std::string options = "-V";
+		if(stage == "vert")
+		{
+			output = getVertexShaderPath();
+			if(!m_drawDataPushConstants)
+			{
+				options += " -DDRAW_DATA_UNIFORM_BUFFER";
+			}
+			if(m_bindless)
+			{
+				options += " -DBINDLESS";
+			}
+		}
+
+		std::string command = "\"" + compiler + "\" " + options + " \"" + source + "\" -o \"" + output + "\"";
+#ifdef _WIN32
+		// cmd /c会去掉最外层的一对引号
+		command = "\"" + command + "\"";
+#endif
+		if(std::system(command.c_str()) != 0)
+		{
+			throw std::runtime_error("failed to compile " + source + "!");
+		}
+	}
+
+	/**
+	 * \brief 在帧与帧之间换上重载的着色器模块和通用管线，旧管线通过延迟删除队列退役
+	 */
+	void applyShaderReload()
+	{
+		ShaderReload& reload = m_shaderReload;
+		if(!reload.m_error.empty())
+		{
+			std::cerr << "shader reload failed: " << reload.m_error << std::endl;
+			return;
+		}
+		if(reload.m_pipeline == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		VkDevice device = m_device;
+		std::vector<VkPipeline> oldPipelines;
+		m_pipelineCompiler.reset([&oldPipelines](VkPipeline pipeline)
+		{
+			oldPipelines.push_back(pipeline);
+		});
+		m_deletionQueue.push(m_frameNumber, [device, oldPipelines]()
+		{
+			for(auto pipeline : oldPipelines)
+			{
+				vkDestroyPipeline(device, pipeline, nullptr);
+			}
+		});
+
+		// 模块只在创建管线时使用，不会被命令缓冲引用，被放弃的变体编译结束后就可以销毁
+		m_pipelineCompiler.waitIdle();
+		vkDestroyShaderModule(m_device, m_vertShaderModule, nullptr);
+		vkDestroyShaderModule(m_device, m_fragShaderModule, nullptr);
+
+		m_vertShaderModule = reload.m_vertShaderModule;
+		m_fragShaderModule = reload.m_fragShaderModule;
+		m_vertShaderHash = reload.m_state.m_vertexShaderHash;
+		m_fragShaderHash = reload.m_state.m_fragmentShaderHash;
+		m_vertReflection = reload.m_vertReflection;
+		m_fragReflection = reload.m_fragReflection;
+		m_pipelineLayout = reload.m_state.m_layout;
+		m_graphicsPipeline = m_pipelineCompiler.adopt(reload.m_state, reload.m_pipeline);
+		m_graphicsPipelineState = reload.m_state;
+		reload = ShaderReload();
+
+		requestSceneVariants(m_graphicsPipelineState);
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_shaderChangeTime).count();
+		std::cout << "shaders reloaded in " << milliseconds << " ms, " << oldPipelines.size() << " pipelines retired" << std::endl;
+	}
+
+	/**
+	 * \brief 等待正在进行的重载并丢弃结果，之后重新开始
+	 */
+	void cancelShaderReload()
+	{
+		if(!m_shaderReloadInFlight)
+		{
+			return;
+		}
+
+		m_jobs.wait(m_shaderReloadJob);
+		m_shaderReloadInFlight = false;
+		destroyShaderReload();
+		m_shaderReloadPending = true;
+	}
+
+	/**
+	 * \brief 销毁重载结果中还没有换上的对象
+	 */
+	void destroyShaderReload()
+	{
+		ShaderReload& reload = m_shaderReload;
+		vkDestroyPipeline(m_device, reload.m_pipeline, nullptr);
+		vkDestroyShaderModule(m_device, reload.m_vertShaderModule, nullptr);
+		vkDestroyShaderModule(m_device, reload.m_fragShaderModule, nullptr);
+		reload.m_pipeline = VK_NULL_HANDLE;
+		reload.m_vertShaderModule = VK_NULL_HANDLE;
+		reload.m_fragShaderModule = VK_NULL_HANDLE;
+	}
+
+	/**
+	 * \brief 为每个交换链图像创建帧缓冲
+	 */
+	void createFramebuffers()
+	{
+		m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
+
+		for(size_t i = 0; i < m_swapChainImageViews.size(); i++)
+		{
+			VkImageView attachments[] = { m_swapChainImageViews[i] };
+
+			VkFramebufferCreateInfo framebufferInfo = {};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = m_renderPass;
+			framebufferInfo.attachmentCount = 1;
+			framebufferInfo.pAttachments = attachments;
+			framebufferInfo.width = m_swapChainExtent.width;
+			framebufferInfo.height = m_swapChainExtent.height;
+			framebufferInfo.layers = 1;
+
+			if(vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_swapChainFramebuffers[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create framebuffer!");
+			}
+		}
+	}
+
+	/**
+	 * \brief 为每个飞行中的帧创建命令池和命令缓冲
+	 */
+	void createFrameResources()
+	{
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_physicalDevice);
+
+		m_frames.resize(m_config.m_framesInFlight);
+
+		for(auto& frame : m_frames)
+		{
+			// 命令缓冲每帧都重新录制，标记为短期使用
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = queueFamilyIndices.m_graphicsFamily;
+
+			if(vkCreateCommandPool(m_device, &poolInfo, nullptr, &frame.m_commandPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create command pool!");
+			}
+
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frame.m_commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			if(vkAllocateCommandBuffers(m_device, &allocInfo, &frame.m_commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate command buffers!");
+			}
+
+			frame.m_secondaryPools.resize(m_config.m_recordJobs);
+			frame.m_secondaryBuffers.resize(m_config.m_recordJobs);
+			for(uint32_t i = 0; i < m_config.m_recordJobs; i++)
+			{
+				if(vkCreateCommandPool(m_device, &poolInfo, nullptr, &frame.m_secondaryPools[i]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create command pool!");
+				}
+
+				VkCommandBufferAllocateInfo secondaryAllocInfo = {};
+				secondaryAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				secondaryAllocInfo.commandPool = frame.m_secondaryPools[i];
+				secondaryAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				secondaryAllocInfo.commandBufferCount = 1;
+
+				if(vkAllocateCommandBuffers(m_device, &secondaryAllocInfo, &frame.m_secondaryBuffers[i]) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate command buffers!");
+				}
+			}
+		}
+	}
+
+	/**
+	 * \brief 创建暂存环形缓冲，每个飞行中的帧一段区域
+	 */
+	void createStagingRing()
+	{
+		m_stagingRing.init(m_device, m_allocator, m_transferQueue, m_queueFamilies.m_transferFamily, m_queueFamilies.m_graphicsFamily,
+			m_config.m_stagingFrameSize, static_cast<uint32_t>(m_frames.size()));
+	}
+
+	/**
+	 * \brief 创建缓冲并从子分配器为其分配绑定内存
+	 * \param size
+	 * \param usage
+	 * \param properties 内存属性
+	 * \param buffer
+	 * \param bufferMemory
+	 */
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if(vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create buffer!");
+		}
+
+		bufferMemory = m_allocator.allocateForBuffer(buffer, properties);
+	}
+
+	/**
+	 * \brief 创建设备本地的顶点缓冲和索引缓冲，并通过暂存环形缓冲上传数据
+	 */
+	void createGeometryBuffers()
+	{
+		// 大量三角形和上传密集的场景使用铺满视口的网格，其他场景使用四边形
+		if(m_config.m_scene == Scene::ManyTriangles || m_config.m_scene == Scene::UploadHeavy)
+		{
+			generateGrid(GRID_CELLS, m_sceneVertices, m_sceneIndices);
+		}
+		else
+		{
+			m_sceneVertices = vertices;
+			m_sceneIndices = indices;
+		}
+
+		VkDeviceSize vertexBufferSize = sizeof(m_sceneVertices[0]) * m_sceneVertices.size();
+		createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexBufferMemory);
+
+		if(m_config.m_scene == Scene::UploadHeavy)
+		{
+			m_dynamicVertexBuffers.resize(m_frames.size());
+			m_dynamicVertexBufferMemory.resize(m_frames.size());
+			for(size_t i = 0; i < m_frames.size(); i++)
+			{
+				createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_dynamicVertexBuffers[i], m_dynamicVertexBufferMemory[i]);
+			}
+		}
+
+		VkDeviceSize indexBufferSize = sizeof(m_sceneIndices[0]) * m_sceneIndices.size();
+		createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexBufferMemory);
+
+		BufferUpload vertexUpload;
+		vertexUpload.m_buffer = m_vertexBuffer;
+		vertexUpload.m_data = m_sceneVertices.data();
+		vertexUpload.m_size = vertexBufferSize;
+		vertexUpload.m_dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		vertexUpload.m_dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+		BufferUpload indexUpload;
+		indexUpload.m_buffer = m_indexBuffer;
+		indexUpload.m_data = m_sceneIndices.data();
+		indexUpload.m_size = indexBufferSize;
+		indexUpload.m_dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		indexUpload.m_dstAccess = VK_ACCESS_INDEX_READ_BIT;
+
+		// 复制录制在第一帧的区域中，随第一帧一起提交，不需要在这里等待
+		if(!m_stagingRing.uploadBuffer(vertexUpload) || !m_stagingRing.uploadBuffer(indexUpload))
+		{
+			throw std::runtime_error("staging ring is too small for the geometry buffers!");
+		}
+	}
+
+	/**
+	 * \brief 无绑定模式下创建材质缓冲并把每个材质注册到无绑定缓冲数组，绘制通过推送常量中的句柄读取材质
+	 */
+	void createMaterials()
+	{
+		if(!m_bindless)
+		{
+			return;
+		}
+
+		// 每个材质是缓冲中的一段，描述符的偏移必须按minStorageBufferOffsetAlignment对齐
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+		VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+		VkDeviceSize stride = (sizeof(Material) + alignment - 1) / alignment * alignment;
+
+		std::vector<char> materialData(static_cast<size_t>(stride * MATERIAL_COUNT));
+		for(uint32_t i = 0; i < MATERIAL_COUNT; i++)
+		{
+			// 按下标的三个位取出不同的颜色，材质0保持顶点颜色不变
+			Material material;
+			material.m_tint = glm::vec4((i & 1) ? 0.5f : 1.0f, (i & 2) ? 0.5f : 1.0f, (i & 4) ? 0.5f : 1.0f, 1.0f);
+			memcpy(materialData.data() + stride * i, &material, sizeof(Material));
+		}
+
+		VkDeviceSize bufferSize = materialData.size();
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_materialBuffer, m_materialBufferMemory);
+
+		BufferUpload upload;
+		upload.m_buffer = m_materialBuffer;
+		upload.m_data = materialData.data();
+		upload.m_size = bufferSize;
+		upload.m_dstStage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+		upload.m_dstAccess = VK_ACCESS_SHADER_READ_BIT;
+		if(!m_stagingRing.uploadBuffer(upload))
+		{
+			throw std::runtime_error("staging ring is too small for the material buffer!");
+		}
+
+		// 缓冲数组是绑定后更新的，注册时不需要等待，第一帧提交时上传已经排在绘制之前
+		m_materialHandles.clear();
+		for(uint32_t i = 0; i < MATERIAL_COUNT; i++)
 		{
-			throw std::runtime_error("failed to set up debug callback!");
+			m_materialHandles.push_back(m_bindlessTable.addBuffer(m_materialBuffer, stride * i, sizeof(Material)));
 		}
 	}
 
 	/**
-	 * \brief ڱ
+	 * \brief 上传密集场景每帧把顶点数据上传到这一帧的顶点缓冲
 	 */
-	void createSurface()
+	void uploadSceneData()
 	{
-		if(glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface) != VK_SUCCESS)
+		if(m_config.m_scene != Scene::UploadHeavy)
 		{
-			throw std::runtime_error("failed to create window surface!");
+			return;
+		}
+
+		// 这一槽位的缓冲上一次被读取的帧已经完成，可以直接覆盖
+		BufferUpload upload;
+		upload.m_buffer = m_dynamicVertexBuffers[m_currentFrame];
+		upload.m_data = m_sceneVertices.data();
+		upload.m_size = sizeof(m_sceneVertices[0]) * m_sceneVertices.size();
+		upload.m_dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		upload.m_dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+		if(!m_stagingRing.uploadBuffer(upload))
+		{
+			throw std::runtime_error("staging ring is too small for the upload-heavy scene, raise --staging-mib!");
 		}
 	}
 
 	/**
-	 * \brief ѡһ豸Կ
+	 * \brief 创建同步对象
 	 */
-	void pickPhysicalDevice()
+	void createSyncObjects()
 	{
-		// Կ
-		uint32_t deviceCount = 0;
-		vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
-
-		if(deviceCount == 0)
-		{
-			throw std::runtime_error("failed to find GPUs with Vulkan support!");
-		}
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-		// 洢VkPhysicalDevice
-		std::vector<VkPhysicalDevice> devices(deviceCount);
-		vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
+		// 栅栏初始为已触发状态，第一轮的帧不需要等待
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-		// ѡһ豸
-		for(const auto& device : devices)
+		for(auto& frame : m_frames)
 		{
-			if(isDeviceSuitable(device))
+			if(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &frame.m_imageAvailableSemaphore) != VK_SUCCESS ||
+				vkCreateFence(m_device, &fenceInfo, nullptr, &frame.m_inFlightFence) != VK_SUCCESS)
 			{
-				m_physicalDevice = device;
-				break;
+				throw std::runtime_error("failed to create synchronization objects for a frame!");
 			}
 		}
 
-		if(m_physicalDevice == VK_NULL_HANDLE)
-		{
-			throw std::runtime_error("failed to find a suitable GPU!");
-		}
+		createPresentSemaphores();
 	}
 
 	/**
-	 * \brief ߼豸
+	 * \brief 为每个交换链图像创建渲染完成信号量，交换链重建后图像数量可能改变
 	 */
-	void createLogicalDevice()
+	void createPresentSemaphores()
 	{
-		QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
-
-		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-		std::set<int> uniqueQueueFamilies = { indices.m_graphicsFamily, indices.m_presentFamily };
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-		float queuePriority = 1.0f;
-		for(int queueFamily : uniqueQueueFamilies)
+		m_renderFinishedSemaphores.resize(m_swapChainImages.size());
+		for(auto& semaphore : m_renderFinishedSemaphores)
 		{
-			// ָҪĶ
-			VkDeviceQueueCreateInfo queueCreateInfo = {};
-			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-			queueCreateInfo.queueFamilyIndex = queueFamily;
-			queueCreateInfo.queueCount = 1;
-			queueCreateInfo.pQueuePriorities = &queuePriority;
-			queueCreateInfos.push_back(queueCreateInfo);
-
+			if(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create synchronization objects for an image!");
+			}
 		}
 
-		// ָʹõ豸
-		VkPhysicalDeviceFeatures deviceFeatures = {};
-
-		// ߼豸
-		VkDeviceCreateInfo createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-		createInfo.pQueueCreateInfos = queueCreateInfos.data();
+		// 新图像还没有被任何帧使用
+		m_imagesInFlight.assign(m_swapChainImages.size(), VK_NULL_HANDLE);
+	}
 
-		createInfo.pEnabledFeatures = &deviceFeatures;
+	/**
+	 * \brief 录制一帧的命令
+	 * \param commandBuffer
+	 * \param imageIndex 目标图像索引
+	 */
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+	{
+		CpuTraceScope traceScope("record");
 
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		if(enableValidationLayers)
+		if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
 		{
-			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-			createInfo.ppEnabledLayerNames = validationLayers.data();
+			throw std::runtime_error("failed to begin recording command buffer!");
 		}
-		else
+
+		// 读取该槽位上一次的时间戳并重置查询池，必须在渲染流程之外
+		m_gpuProfiler.beginFrame(commandBuffer, m_currentFrame);
 		{
-			createInfo.enabledLayerCount = 0;
+			GpuProfiler::Scope frameScope(m_gpuProfiler, commandBuffer, "frame");
+
+			// 获取专用传输队列上传的资源的所有权，必须在渲染流程之外
+			m_stagingRing.recordAcquireBarriers(commandBuffer);
+
+			recordMainPass(commandBuffer, imageIndex);
 		}
 
-		if(vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device) != VK_SUCCESS)
+		if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
 		{
-			throw std::runtime_error("failed to create logical device!");
+			throw std::runtime_error("failed to record command buffer!");
 		}
-
-		// ȡо
-		vkGetDeviceQueue(m_device, indices.m_graphicsFamily, 0, &m_graphicsQueue);
-		vkGetDeviceQueue(m_device, indices.m_presentFamily, 0, &m_presentQueue);
 	}
 
 	/**
-	 * \brief 
+	 * \brief 录制主渲染流程
+	 * \param commandBuffer
+	 * \param imageIndex 目标图像索引
 	 */
-	void createSwapChain()
+	void recordMainPass(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 	{
-		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_physicalDevice);
-
-		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.m_formats);
-		VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.m_presentModes);
-		VkExtent2D extent = chooseSwapExtent(swapChainSupport.m_capabilities);
-
-		// ýпɵͼ
-		uint32_t imageCount = swapChainSupport.m_capabilities.minImageCount + 1;
-		// maxImageCountֵΪ0ֻҪڴ㣬ʹͼ
-		if(swapChainSupport.m_capabilities.maxImageCount > 0 &&  imageCount > swapChainSupport.m_capabilities.maxImageCount)
-		{
-			imageCount = swapChainSupport.m_capabilities.maxImageCount;
-		}
+		GpuProfiler::Scope mainPassScope(m_gpuProfiler, commandBuffer, "main pass");
 
-		VkSwapchainCreateInfoKHR createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-		createInfo.surface = m_surface;
+		VkClearValue clearColor = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
 
-		createInfo.minImageCount = imageCount;
-		createInfo.imageFormat = surfaceFormat.format;
-		createInfo.imageColorSpace = surfaceFormat.colorSpace;
-		createInfo.imageExtent = extent;
-		createInfo.imageArrayLayers = 1;
-		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = m_renderPass;
+		renderPassInfo.framebuffer = m_swapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = m_swapChainExtent;
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearColor;
 
-		QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
-		uint32_t queueFamilyIndices[] = { (uint32_t)indices.m_graphicsFamily, (uint32_t)indices.m_presentFamily };
+		uint32_t drawCount = getSceneDrawCount();
 
-		if(indices.m_graphicsFamily != indices.m_presentFamily)
+		if(m_config.m_recordJobs == 0)
 		{
-			createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-			createInfo.queueFamilyIndexCount = 2;
-			createInfo.pQueueFamilyIndices = queueFamilyIndices;
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			recordDraws(commandBuffer, 0, drawCount);
 		}
 		else
 		{
-			createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			createInfo.queueFamilyIndexCount = 0;	// Optional
-			createInfo.pQueueFamilyIndices = nullptr;	// Optional
-		}
+			// 渲染流程的内容全部来自次级命令缓冲，主命令缓冲里不能再有内联的绘制命令
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-		createInfo.preTransform = swapChainSupport.m_capabilities.currentTransform;
-		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-		createInfo.presentMode = presentMode;
-		createInfo.clipped = VK_TRUE;
-		createInfo.oldSwapchain = VK_NULL_HANDLE;
+			FrameData& frame = m_frames[m_currentFrame];
+			VkFramebuffer framebuffer = m_swapChainFramebuffers[imageIndex];
+			uint32_t jobCount = m_config.m_recordJobs;
 
-		if(vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to create swap chain!");
+			JobCounter recorded;
+			m_jobs.parallelFor(jobCount, [&](uint32_t jobIndex)
+			{
+				// 按任务均分连续的绘制区间，每个任务只使用自己的命令池
+				uint32_t firstDraw = drawCount * jobIndex / jobCount;
+				uint32_t lastDraw = drawCount * (jobIndex + 1) / jobCount;
+				recordSecondary(frame.m_secondaryPools[jobIndex], frame.m_secondaryBuffers[jobIndex], framebuffer, firstDraw, lastDraw - firstDraw);
+			}, recorded);
+			m_jobs.wait(recorded);
+
+			vkCmdExecuteCommands(commandBuffer, jobCount, frame.m_secondaryBuffers.data());
 		}
+		m_drawCount += drawCount;
+		m_pipelineCompiler.endFrame();
 
-		vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, nullptr);
-		m_swapChainImages.resize(imageCount);
-		vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, m_swapChainImages.data());
-
-		m_swapChainImageFormat = surfaceFormat.format;
-		m_swapChainExtent = extent;
-
+		vkCmdEndRenderPass(commandBuffer);
 	}
 
 	/**
-	 * \brief ͼͼ
+	 * \brief 当前场景每帧的绘制次数
+	 * \return
 	 */
-	void createImageViews()
+	uint32_t getSceneDrawCount() const
 	{
-		// ռ洢ͼͼ
-		m_swapChainImageViews.resize(m_swapChainImages.size());
-
-		// нͼ񣬴ͼͼ
-		for(size_t i = 0; i < m_swapChainImages.size(); i++)
+		if(m_config.m_scene == Scene::ManyDraws)
 		{
-			VkImageViewCreateInfo createInfo = {};
-			createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-			createInfo.image = m_swapChainImages[i];
-
-			// ָͼݵĽͷʽ
-			createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-			createInfo.format = m_swapChainImageFormat;
-
-			// ָͼɫͨӳ
-			createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-			createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-			createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-			createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-			// ָͼ;ͼһֿԱ
-			createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			createInfo.subresourceRange.baseMipLevel = 0;
-			createInfo.subresourceRange.levelCount = 1;
-			createInfo.subresourceRange.baseArrayLayer = 0;
-			createInfo.subresourceRange.layerCount = 1;
-
-			// ͼͼ
-			if(vkCreateImageView(m_device, &createInfo, nullptr, &m_swapChainImageViews[i]) != VK_SUCCESS)
-			{
-				throw std::runtime_error("failed to create image views!");
-			}
+			return MANY_DRAWS_COUNT;
+		}
+		if(m_config.m_scene == Scene::ManyPipelines)
+		{
+			return MANY_PIPELINES_DRAWS;
 		}
+		return 1;
 	}
 
 	/**
-	 * \brief ͼι
+	 * \brief 录制绘制列表中的一段，只读取应用状态，可以在多个线程上同时调用
+	 * \param commandBuffer 已经处于渲染流程中的命令缓冲
+	 * \param firstDraw
+	 * \param drawCount
 	 */
-	void createGraphicsPipeline()
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)
 	{
-		auto vertShaderCode = readFile("shaders/vert.spv");
-		auto fragShaderCode = readFile("shaders/frag.spv");
-		
-		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-
-		VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertShaderStageInfo.module = vertShaderModule;
-		vertShaderStageInfo.pName = "main";
-
-		VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = fragShaderModule;
-		fragShaderStageInfo.pName = "main";
-
-		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 0;
-		vertexInputInfo.pVertexBindingDescriptions = nullptr;	// Optional
-		vertexInputInfo.vertexAttributeDescriptionCount = 0;
-		vertexInputInfo.pVertexAttributeDescriptions = nullptr;	// Optional
-
-		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		inputAssembly.primitiveRestartEnable = VK_FALSE;
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+
+		// 所有管线布局的集合0都是同一个布局，切换管线之后仍然有效，绘制之间不需要再绑定
+		if(m_bindless)
+		{
+			VkDescriptorSet bindlessSet = m_bindlessTable.getDescriptorSet();
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, BINDLESS_SET, 1, &bindlessSet, 0, nullptr);
+		}
+
+		VkBuffer vertexBuffers[] = { m_config.m_scene == Scene::UploadHeavy ? m_dynamicVertexBuffers[m_currentFrame] : m_vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
 
+		// 动态状态不会在命令缓冲之间继承，每个命令缓冲都要重新设置
 		VkViewport viewport = {};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
@@ -596,29 +3808,120 @@ private:
 		viewport.height = (float)m_swapChainExtent.height;
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
 		VkRect2D scissor = {};
 		scissor.offset = { 0, 0 };
 		scissor.extent = m_swapChainExtent;
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+		VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+		if(m_extendedDynamicState)
+		{
+			m_vkCmdSetCullModeEXT(commandBuffer, cullMode);
+			m_vkCmdSetFrontFaceEXT(commandBuffer, frontFace);
+			m_vkCmdSetPrimitiveTopologyEXT(commandBuffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+			m_vkCmdSetDepthTestEnableEXT(commandBuffer, VK_FALSE);
+			m_vkCmdSetDepthWriteEnableEXT(commandBuffer, VK_FALSE);
+			m_vkCmdSetDepthCompareOpEXT(commandBuffer, VK_COMPARE_OP_LESS);
+		}
+
+		uint32_t indexCount = static_cast<uint32_t>(m_sceneIndices.size());
+		VkPipeline boundPipeline = m_graphicsPipeline;
+		for(uint32_t i = firstDraw; i < firstDraw + drawCount; i++)
+		{
+			if(!m_sceneVariants.empty())
+			{
+				const SceneVariant& variant = m_sceneVariants[i % m_sceneVariants.size()];
+				VkPipeline pipeline = m_pipelineCompiler.get(variant.m_pipeline);
+				if(pipeline == VK_NULL_HANDLE)
+				{
+					// 管线还在编译，不等待
+					if(m_config.m_skipPendingPipelines)
+					{
+						continue;
+					}
+					pipeline = m_graphicsPipeline;
+				}
+
+				if(pipeline != boundPipeline)
+				{
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+					boundPipeline = pipeline;
+				}
+
+				if(m_extendedDynamicState && variant.m_cullMode != cullMode)
+				{
+					m_vkCmdSetCullModeEXT(commandBuffer, variant.m_cullMode);
+					cullMode = variant.m_cullMode;
+				}
+				if(m_extendedDynamicState && variant.m_frontFace != frontFace)
+				{
+					m_vkCmdSetFrontFaceEXT(commandBuffer, variant.m_frontFace);
+					frontFace = variant.m_frontFace;
+				}
+			}
+
+			// 推送常量直接录制在命令缓冲中；否则写入这一帧缓冲中绘制自己的槽位，
+			// 不同的录制任务写入不同的槽位，重新绑定描述符集只改变动态偏移
+			DrawData drawData = getDrawData(i);
+			if(m_drawDataPushConstants)
+			{
+				vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawData), &drawData);
+			}
+			else
+			{
+				const FrameData& frame = m_frames[m_currentFrame];
+				uint32_t offset = static_cast<uint32_t>(m_drawDataStride * i);
+				memcpy(static_cast<char*>(frame.m_drawDataMemory.m_mapped) + offset, &drawData, sizeof(DrawData));
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, DRAW_DATA_SET, 1, &frame.m_drawDataSet, 1, &offset);
+			}
+			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+		}
+	}
+
+	/**
+	 * \brief 在任务线程上录制一个次级命令缓冲
+	 * \param pool 该任务本帧独占的命令池
+	 * \param commandBuffer 从pool分配的次级命令缓冲
+	 * \param framebuffer
+	 * \param firstDraw
+	 * \param drawCount
+	 */
+	void recordSecondary(VkCommandPool pool, VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, uint32_t firstDraw, uint32_t drawCount)
+	{
+		CpuTraceScope traceScope("record secondary");
+
+		// 该帧的栅栏已经等待过，上一次的命令缓冲不再使用，整体重置命令池
+		vkResetCommandPool(m_device, pool, 0);
+
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = m_renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = framebuffer;
 
-		VkPipelineViewportStateCreateInfo viewportState = {};
-		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		viewportState.viewportCount = 1;
-		viewportState.pViewports = &viewport;
-		viewportState.scissorCount = 1;
-		viewportState.pScissors = &scissor;
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
 
-		VkPipelineRasterizationStateCreateInfo rasterizer = {};
-		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		rasterizer.depthClampEnable = VK_FALSE;
-		rasterizer.rasterizerDiscardEnable = VK_FALSE;
+		if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to begin recording command buffer!");
+		}
 
-		vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
-		vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+		recordDraws(commandBuffer, firstDraw, drawCount);
+
+		if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to record command buffer!");
+		}
 	}
 
 	/**
-	 * \brief 豸Ƿ
+	 * \brief 设备是否满足需求
 	 * \param device 
 	 * \return 
 	 */
@@ -628,9 +3931,9 @@ private:
 
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-		// 򵥴ֻ轻֧һͼʽһ֧ǵĴڱĳģʽ
-		bool swapChainAdequate = false;
-		if(extensionsSupported)
+		// 这里简单处理，只需交换链支持一种图像格式和一种支持我们的窗口表面的呈现模式即可
+		bool swapChainAdequate = m_config.m_headless;
+		if(extensionsSupported && !m_config.m_headless)
 		{
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 			swapChainAdequate = !swapChainSupport.m_formats.empty() && !swapChainSupport.m_presentModes.empty();
@@ -640,21 +3943,36 @@ private:
 	}
 
 	/**
-	 * \brief 豸չǷ֧
+	 * \brief 返回所需的设备扩展列表，无窗口模式不需要交换链扩展
+	 * \return
+	 */
+	std::vector<const char*> getRequiredDeviceExtensions()
+	{
+		if (m_config.m_headless)
+		{
+			return {};
+		}
+
+		return deviceExtensions;
+	}
+
+	/**
+	 * \brief 检查设备扩展是否被支持
 	 * \param device 
 	 * \return 
 	 */
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device)
 	{
-		// ǰõ豸չб
+		// 构建当前可用的设备扩展列表
 		uint32_t extensionCount;
 		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
 		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-		// еչ޳еԪΪ0˵չȫ
-		std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+		// 将集合中的扩展剔除，如果集合中的元素为0，说明所需的扩展全部都被满足
+		std::vector<const char*> extensions = getRequiredDeviceExtensions();
+		std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 		for(const auto& extension : availableExtensions)
 		{
 			requiredExtensions.erase(extension.extensionName);
@@ -664,7 +3982,7 @@ private:
 	}
 
 	/**
-	 * \brief ѰĶ
+	 * \brief 寻找满足条件的队列族
 	 * \param device 
 	 * \return 
 	 */
@@ -672,18 +3990,18 @@ private:
 	{
 		QueueFamilyIndices indices;
 
-		// ȡ豸Ķ
+		// 获取设备的队列族个数
 		uint32_t queueFamilyCount = 0;
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 
-		// 洢VkQueueFamilyProperties
+		// 分配数组存储队列族的VkQueueFamilyProperties对象
 		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
 		int i = 0;
 		for(const auto& queueFamily : queueFamilies)
 		{
-			// ȷָֻ֧Ķ
+			// 确定支持绘制指令的队列族索引
 			if(queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
 			{
 				indices.m_graphicsFamily = i;
@@ -691,9 +4009,17 @@ private:
 
 
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+			if(m_config.m_headless)
+			{
+				// 无窗口模式没有表面，呈现队列直接使用图形队列族
+				presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+			}
+			else
+			{
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+			}
 
-			// ȷֱֵ֧Ķ
+			// 确定支持表现的队列族索引
 			if(queueFamily.queueCount > 0 && presentSupport)
 			{
 				indices.m_presentFamily = i;
@@ -707,11 +4033,49 @@ private:
 			i++;
 		}
 
+		// 专用队列族让上传和计算可以与图形工作并行，而不是在图形队列上排队
+		for(uint32_t family = 0; family < queueFamilyCount; family++)
+		{
+			VkQueueFlags flags = queueFamilies[family].queueFlags;
+			if(queueFamilies[family].queueCount == 0 || (flags & VK_QUEUE_GRAPHICS_BIT))
+			{
+				continue;
+			}
+
+			// 只支持传输的族通常对应独立的DMA引擎
+			bool transferOnly = (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT);
+			if(transferOnly && indices.m_transferFamily < 0)
+			{
+				indices.m_transferFamily = family;
+			}
+
+			if((flags & VK_QUEUE_COMPUTE_BIT) && indices.m_computeFamily < 0)
+			{
+				indices.m_computeFamily = family;
+			}
+		}
+
+		// 没有只支持传输的族时，计算队列族也能执行传输命令
+		if(indices.m_transferFamily < 0)
+		{
+			indices.m_transferFamily = indices.m_computeFamily;
+		}
+
+		// 没有专用族时退回到图形队列族
+		if(indices.m_computeFamily < 0)
+		{
+			indices.m_computeFamily = indices.m_graphicsFamily;
+		}
+		if(indices.m_transferFamily < 0)
+		{
+			indices.m_transferFamily = indices.m_graphicsFamily;
+		}
+
 		return indices;
 	}
 
 	/**
-	 * \brief ѯǷ֧
+	 * \brief 查询交换链是否支持
 	 * \param device 
 	 * \return 
 	 */
@@ -719,10 +4083,10 @@ private:
 	{
 		SwapChainSupportDetails details;
 
-		// ѯ
+		// 查询基础表面特性
 		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, m_surface, &details.m_capabilities);
 
-		// ѯֵ֧ĸʽ
+		// 查询表面支持的格式
 		uint32_t formatCount;
 		vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
 
@@ -732,7 +4096,7 @@ private:
 			vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, details.m_formats.data());
 		}
 
-		// ѯֵ֧ĳָʽ
+		// 查询支持的呈现格式
 		uint32_t presentModeCount;
 		vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, nullptr);
 
@@ -746,19 +4110,19 @@ private:
 	}
 
 	/**
-	 * \brief ѡʵıʽ
+	 * \brief 选择合适的表面格式
 	 * \param availableFormats 
 	 * \return 
 	 */
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats)
 	{
-		// ûԼѡʽ򷵻趨ĸʽ
+		// 如果表面没有自己的首选格式，则返回设定的格式
 		if(availableFormats.size() == 1 && availableFormats[0].format == VK_FORMAT_UNDEFINED)
 		{
 			return { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
 		}
 
-		// һʽбҪ趨ĸʽǷб
+		// 如果是一个格式列表，则检查我们想要的设定的格式是否存在于列表中
 		for(const auto& availableFormat : availableFormats)
 		{
 			if(availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
@@ -766,36 +4130,33 @@ private:
 				return availableFormat;
 			}
 		}
+
+		// 没有想要的格式时，使用表面列出的第一个格式
+		return availableFormats[0];
 	}
 
 	/**
-	 * \brief ѡѵĿóģʽ
+	 * \brief 按配置档选择呈现模式
 	 * \param availablePresentModes 
 	 * \return 
 	 */
 	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes)
 	{
-		// һͨģʽ
-		VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
-
-		// ʹģʽ
-		for(const auto& availablePresentMode : availablePresentModes)
+		PresentPolicy policy = getPresentPolicy(m_config.m_presentProfile);
+		for(VkPresentModeKHR preferredMode : policy.m_presentModes)
 		{
-			if(availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-			{
-				return availablePresentMode;
-			}
-			else if(availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+			if(std::find(availablePresentModes.begin(), availablePresentModes.end(), preferredMode) != availablePresentModes.end())
 			{
-				bestMode = availablePresentMode;
+				return preferredMode;
 			}
 		}
 
-		return bestMode;
+		// FIFO是所有实现都必须支持的模式
+		return VK_PRESENT_MODE_FIFO_KHR;
 	}
 
 	/**
-	 * \brief ѡ񽻻Χ
+	 * \brief 选择交换范围
 	 * \param capabilities 
 	 * \return 
 	 */
@@ -807,7 +4168,15 @@ private:
 		}
 		else
 		{
-			VkExtent2D actualExtent = { WIDTH, HEIGHT };
+			VkExtent2D actualExtent = { m_config.m_width, m_config.m_height };
+
+			// 窗口大小可能已经改变，以帧缓冲的实际像素为准
+			if(m_window != nullptr)
+			{
+				int width, height;
+				glfwGetFramebufferSize(m_window, &width, &height);
+				actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+			}
 
 			actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
 			actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
@@ -817,19 +4186,22 @@ private:
 	}
 
 	/**
-	 * \brief VkShaderModule
-	 * \param code 
-	 * \return 
+	 * \brief 从一段SPIR-V字节码创建VkShaderModule对象，不做拷贝
+	 * \param code 必须按4字节对齐
+	 * \param size 字节数
+	 * \return
 	 */
-	VkShaderModule createShaderModule(const std::vector<char>& code)
+	VkShaderModule createShaderModule(const void* code, size_t size)
 	{
-		// ָVkShaderModuleCreateInfo洢ֽ鳤
+		validateSpirv(code, size);
+
+		// 指定VkShaderModuleCreateInfo存储字节码的数组和数组长度
 		VkShaderModuleCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		createInfo.codeSize = size;
+		createInfo.pCode = static_cast<const uint32_t*>(code);
 
-		// VkShaderModule
+		// 创建VkShaderModule对象
 		VkShaderModule shaderModule;
 		if(vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
 		{
@@ -840,36 +4212,33 @@ private:
 	}
 
 	/**
-	 * \brief ļĸ
-	 * \param filename 
-	 * \return 
+	 * \brief 检查字节码能否安全地作为uint32_t数组交给驱动
+	 * \param code
+	 * \param size
 	 */
-	static std::vector<char> readFile(const std::string& filename)
+	static void validateSpirv(const void* code, size_t size)
 	{
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-		if(!file.is_open())
+		// SPIR-V头部固定为5个字
+		if(size < 5 * sizeof(uint32_t) || size % sizeof(uint32_t) != 0)
 		{
-			throw std::runtime_error("failed to open file!");
+			throw std::runtime_error("invalid SPIR-V size!");
 		}
 
-		// ݶȡλȷļС㹻ռ
-		size_t fileSize = (size_t)file.tellg();
-		std::vector<char> buffer(fileSize);
-
-		// ȡļ
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-
-		file.close();
+		if(reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) != 0)
+		{
+			throw std::runtime_error("SPIR-V code is not 4-byte aligned!");
+		}
 
-		return buffer;
+		if(static_cast<const uint32_t*>(code)[0] != 0x07230203)
+		{
+			throw std::runtime_error("invalid SPIR-V magic number!");
+		}
 	}
 
 	/**
-	 * \brief ܵϢĻص
-	 * \param messageSeverity Ϣļ
-	 * \param messageType Ϣ
+	 * \brief 接受调试信息的回调函数
+	 * \param messageSeverity 消息的级别
+	 * \param messageType 消息的类型
 	 * \param pCallbackData
 	 * \param pUserData
 	 * \return
@@ -886,13 +4255,58 @@ private:
 	}
 };
 
-int main()
+#ifdef LEARNVULKAN_BENCHMARK
+/**
+ * \brief 基准测试程序：无窗口、固定分辨率，依次运行所有场景并导出结果
+ */
+int main(int argc, char** argv)
 {
-	HelloTriangleApplication app;
+	try
+	{
+		AppConfig config = parseCommandLine(argc, argv);
+		config.m_headless = true;
+		if (config.m_frameCount == 0)
+		{
+			config.m_frameCount = 1000;
+		}
+		if (config.m_benchmarkPath.empty())
+		{
+			config.m_benchmarkPath = "benchmark.json";
+		}
+
+		std::vector<BenchmarkResult> results;
+		for (Scene scene : allScenes)
+		{
+			config.m_scene = scene;
+			HelloTriangleApplication app(config);
+			app.run();
+			results.push_back(app.getBenchmarkResult());
+		}
+
+		writeBenchmarkReport(config.m_benchmarkPath, results);
+		std::cout << "benchmark results written to " << config.m_benchmarkPath << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
 
+	return EXIT_SUCCESS;
+}
+#else
+int main(int argc, char** argv)
+{
 	try
 	{
+		AppConfig config = parseCommandLine(argc, argv);
+		HelloTriangleApplication app(config);
 		app.run();
+
+		if (!config.m_benchmarkPath.empty())
+		{
+			writeBenchmarkReport(config.m_benchmarkPath, { app.getBenchmarkResult() });
+		}
 	}
 	catch (const std::exception& e)
 	{
@@ -902,5 +4316,6 @@ int main()
 
 	return EXIT_SUCCESS;
 }
+#endif
 #else
 #endif
\ No newline at end of file
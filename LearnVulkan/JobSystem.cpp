@@ -0,0 +1,320 @@
+#include "JobSystem.h"
+
+#include <iostream>
+
+#include "CpuTrace.h"
+
+namespace
+{
+	// 当前线程所属的调度器和在其中的索引
+	thread_local const JobSystem* t_jobSystem = nullptr;
+	thread_local uint32_t t_workerIndex = UINT32_MAX;
+}
+
+JobSystem::~JobSystem()
+{
+	destroy();
+}
+
+void JobSystem::init(uint32_t threadCount)
+{
+	m_stopping = false;
+	m_mainThreadId = std::this_thread::get_id();
+	t_jobSystem = this;
+	t_workerIndex = 0;
+
+	m_workers.clear();
+	for (uint32_t i = 0; i <= threadCount; i++)
+	{
+		m_workers.emplace_back(new Worker());
+	}
+
+	m_threads.reserve(threadCount);
+	for (uint32_t i = 1; i <= threadCount; i++)
+	{
+		m_threads.emplace_back(&JobSystem::workerMain, this, i, "job worker " + std::to_string(i));
+	}
+}
+
+void JobSystem::destroy()
+{
+	m_stopping = true;
+	wakeAll();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+	m_workers.clear();
+	m_mainJobs.clear();
+	m_queuedJobs = 0;
+	m_queuedMainJobs = 0;
+
+	if (t_jobSystem == this)
+	{
+		t_jobSystem = nullptr;
+		t_workerIndex = UINT32_MAX;
+	}
+}
+
+bool JobSystem::isMainThread() const
+{
+	return std::this_thread::get_id() == m_mainThreadId;
+}
+
+uint32_t JobSystem::getCurrentWorker() const
+{
+	return t_jobSystem == this ? t_workerIndex : UINT32_MAX;
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter* counter, JobCounter* dependency)
+{
+	if (counter != nullptr)
+	{
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Job entry;
+	entry.m_function = std::move(job);
+	entry.m_counter = counter;
+
+	if (dependency != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(dependency->m_mutex);
+		if (dependency->m_pending.load(std::memory_order_acquire) != 0)
+		{
+			// 依赖完成时由finish放入队列
+			dependency->m_waiting.push_back(std::move(entry));
+			return;
+		}
+	}
+
+	push(std::move(entry));
+}
+
+void JobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t)>& job, JobCounter& counter)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		run([job, i]() { job(i); }, &counter);
+	}
+}
+
+void JobSystem::runOnMainThread(std::function<void()> job, JobCounter* counter)
+{
+	if (counter != nullptr)
+	{
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mainMutex);
+		Job entry;
+		entry.m_function = std::move(job);
+		entry.m_counter = counter;
+		m_mainJobs.push_back(std::move(entry));
+		m_queuedMainJobs++;
+	}
+	wakeAll();
+}
+
+bool JobSystem::pumpMainThread()
+{
+	bool executed = false;
+	while (m_queuedMainJobs.load(std::memory_order_acquire) != 0)
+	{
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(m_mainMutex);
+			if (m_mainJobs.empty())
+			{
+				break;
+			}
+			job = std::move(m_mainJobs.front());
+			m_mainJobs.pop_front();
+			m_queuedMainJobs--;
+		}
+		execute(job);
+		executed = true;
+	}
+	return executed;
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	uint32_t workerIndex = getCurrentWorker();
+	bool mainThread = isMainThread();
+
+	while (!counter.isDone())
+	{
+		if (mainThread && pumpMainThread())
+		{
+			continue;
+		}
+
+		Job job;
+		if (workerIndex != UINT32_MAX && pop(workerIndex, job))
+		{
+			execute(job);
+			continue;
+		}
+
+		// 没有可以帮忙的任务，休眠到计数完成或有新任务
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [&]()
+		{
+			return counter.isDone() || (workerIndex != UINT32_MAX && m_queuedJobs.load() != 0) ||
+				(mainThread && m_queuedMainJobs.load() != 0);
+		});
+	}
+
+	// 完成者在锁内把计数减到零，拿到锁之后它已经不再访问计数器，调用者可以安全地销毁计数器
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+	if (counter.m_exception)
+	{
+		std::exception_ptr exception = counter.m_exception;
+		counter.m_exception = nullptr;
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobSystem::push(Job job)
+{
+	uint32_t workerIndex = getCurrentWorker();
+	if (workerIndex == UINT32_MAX)
+	{
+		workerIndex = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+	}
+
+	{
+		Worker& worker = *m_workers[workerIndex];
+		std::lock_guard<std::mutex> lock(worker.m_mutex);
+		worker.m_jobs.push_back(std::move(job));
+		m_queuedJobs++;
+	}
+	wakeAll();
+}
+
+bool JobSystem::pop(uint32_t workerIndex, Job& job)
+{
+	if (m_queuedJobs.load(std::memory_order_acquire) == 0)
+	{
+		return false;
+	}
+
+	// 自己队列尾部的任务最近提交，数据更可能还在缓存里
+	{
+		Worker& worker = *m_workers[workerIndex];
+		std::lock_guard<std::mutex> lock(worker.m_mutex);
+		if (!worker.m_jobs.empty())
+		{
+			job = std::move(worker.m_jobs.back());
+			worker.m_jobs.pop_back();
+			m_queuedJobs--;
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < m_workers.size(); i++)
+	{
+		Worker& victim = *m_workers[(workerIndex + i) % m_workers.size()];
+		std::lock_guard<std::mutex> lock(victim.m_mutex);
+		if (!victim.m_jobs.empty())
+		{
+			job = std::move(victim.m_jobs.front());
+			victim.m_jobs.pop_front();
+			m_queuedJobs--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(Job& job)
+{
+	try
+	{
+		job.m_function();
+	}
+	catch (...)
+	{
+		if (job.m_counter == nullptr)
+		{
+			// 没有人等待这个任务，异常只能在这里报告
+			try
+			{
+				throw;
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "job failed: " << e.what() << std::endl;
+			}
+			catch (...)
+			{
+				std::cerr << "job failed" << std::endl;
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(job.m_counter->m_mutex);
+			if (!job.m_counter->m_exception)
+			{
+				job.m_counter->m_exception = std::current_exception();
+			}
+		}
+	}
+
+	finish(job.m_counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+	if (counter == nullptr)
+	{
+		return;
+	}
+
+	std::vector<Job> released;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			return;
+		}
+		released.swap(counter->m_waiting);
+	}
+
+	for (auto& job : released)
+	{
+		push(std::move(job));
+	}
+	wakeAll();
+}
+
+void JobSystem::wakeAll()
+{
+	// 在锁内通知，避免等待者检查条件之后、休眠之前错过唤醒
+	std::lock_guard<std::mutex> lock(m_sleepMutex);
+	m_wake.notify_all();
+}
+
+void JobSystem::workerMain(uint32_t workerIndex, std::string name)
+{
+	t_jobSystem = this;
+	t_workerIndex = workerIndex;
+	CpuTrace::setThreadName(name);
+
+	while (!m_stopping)
+	{
+		Job job;
+		if (pop(workerIndex, job))
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this]() { return m_stopping.load() || m_queuedJobs.load() != 0; });
+	}
+}
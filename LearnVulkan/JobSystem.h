@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief 一组任务的完成计数，也用作任务之间的依赖
+ *
+ * 提交任务时计数加一，任务结束时减一，减到零表示这一组任务全部完成。
+ * 计数器必须比关联的任务活得更久，通常放在等待它的函数的栈上。
+ */
+class JobCounter
+{
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const
+	{
+		return m_pending.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	struct Job
+	{
+		std::function<void()> m_function;
+		JobCounter* m_counter = nullptr;
+	};
+
+	std::atomic<uint32_t> m_pending{ 0 };
+
+	// 保护m_waiting和m_exception，计数减到零也在锁内进行
+	std::mutex m_mutex;
+
+	// 依赖这个计数器的任务，计数减到零时才放入队列
+	std::vector<Job> m_waiting;
+
+	// 这一组任务抛出的第一个异常，由wait重新抛出
+	std::exception_ptr m_exception;
+};
+
+/**
+ * \brief 任务窃取式的任务调度器
+ *
+ * 每个线程（包括主线程）有自己的双端队列：自己从尾部取最近提交的任务，
+ * 空闲时从其他线程的队列头部窃取最早的任务。等待计数器的线程不会闲着，
+ * 会一边等待一边执行队列中的任务。
+ *
+ * GLFW的窗口和事件函数只能在主线程调用，这类任务用runOnMainThread提交，
+ * 由主线程在pumpMainThread或wait中执行。
+ */
+class JobSystem
+{
+public:
+	JobSystem() = default;
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/**
+	 * \brief 启动后台工作线程，调用线程成为主线程
+	 * \param threadCount 后台线程数，为0时所有任务都在主线程的wait中执行
+	 */
+	void init(uint32_t threadCount);
+
+	/**
+	 * \brief 停止并等待所有后台线程退出，尚未执行的任务被丢弃
+	 */
+	void destroy();
+
+	/**
+	 * \brief 参与执行任务的线程数，包括主线程
+	 * \return
+	 */
+	uint32_t getThreadCount() const
+	{
+		return static_cast<uint32_t>(m_workers.size());
+	}
+
+	bool isMainThread() const;
+
+	/**
+	 * \brief 提交一个任务
+	 * \param job
+	 * \param counter 任务完成时递减，可以为空
+	 * \param dependency 不为空时，等它的计数减到零之后任务才开始执行
+	 */
+	void run(std::function<void()> job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	/**
+	 * \brief 提交count个任务，第i个任务执行job(i)
+	 * \param count
+	 * \param job
+	 * \param counter
+	 */
+	void parallelFor(uint32_t count, const std::function<void(uint32_t)>& job, JobCounter& counter);
+
+	/**
+	 * \brief 提交一个只能在主线程上执行的任务
+	 * \param job
+	 * \param counter 可以为空
+	 */
+	void runOnMainThread(std::function<void()> job, JobCounter* counter = nullptr);
+
+	/**
+	 * \brief 执行所有排队的主线程任务，只能在主线程调用
+	 * \return 是否执行了任务
+	 */
+	bool pumpMainThread();
+
+	/**
+	 * \brief 等待计数减到零，期间执行队列中的任务
+	 * \param counter 其中任务抛出的第一个异常会在这里重新抛出
+	 */
+	void wait(JobCounter& counter);
+
+private:
+	typedef JobCounter::Job Job;
+
+	/**
+	 * \brief 一个线程的任务队列，所有者从尾部存取，其他线程从头部窃取
+	 */
+	struct Worker
+	{
+		std::mutex m_mutex;
+		std::deque<Job> m_jobs;
+	};
+
+	// 索引0是主线程
+	std::vector<std::unique_ptr<Worker>> m_workers;
+
+	std::vector<std::thread> m_threads;
+
+	std::thread::id m_mainThreadId;
+
+	std::mutex m_mainMutex;
+	std::deque<Job> m_mainJobs;
+	std::atomic<uint32_t> m_queuedMainJobs{ 0 };
+
+	// 所有线程队列中的任务总数，空闲线程据此决定是否休眠
+	std::atomic<uint32_t> m_queuedJobs{ 0 };
+
+	// 不属于调度器的线程提交任务时轮流放入各个队列
+	std::atomic<uint32_t> m_nextQueue{ 0 };
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+
+	std::atomic<bool> m_stopping{ false };
+
+	/**
+	 * \brief 当前线程在m_workers中的索引，不属于这个调度器时返回UINT32_MAX
+	 * \return
+	 */
+	uint32_t getCurrentWorker() const;
+
+	void push(Job job);
+
+	/**
+	 * \brief 从自己的队列尾部取一个任务，没有时从其他队列头部窃取
+	 * \param workerIndex
+	 * \param job
+	 * \return
+	 */
+	bool pop(uint32_t workerIndex, Job& job);
+
+	void execute(Job& job);
+
+	/**
+	 * \brief 计数减一，减到零时放行依赖它的任务并唤醒等待者
+	 * \param counter
+	 */
+	void finish(JobCounter* counter);
+
+	void wakeAll();
+
+	void workerMain(uint32_t workerIndex, std::string name);
+};
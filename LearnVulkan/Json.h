@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+/**
+ * \brief 转义JSON字符串中的引号、反斜杠和控制字符，结果可以直接放进双引号之间
+ * \param text
+ * \return
+ */
+inline std::string escapeJson(const std::string& text)
+{
+	std::string result;
+	result.reserve(text.size());
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			result += '\\';
+			result += c;
+		}
+		else if (c == '\n')
+		{
+			result += "\\n";
+		}
+		else if (c == '\t')
+		{
+			result += "\\t";
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+			result += escaped;
+		}
+		else
+		{
+			result += c;
+		}
+	}
+	return result;
+}
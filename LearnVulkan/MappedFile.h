@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * \brief 只读的内存映射文件，映射在对象析构时解除
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+
+	/**
+	 * \brief 以只读方式映射整个文件，失败时抛出异常
+	 * \param filename
+	 */
+	explicit MappedFile(const std::string& filename);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	/**
+	 * \brief 映射的起始地址，总是按页对齐
+	 * \return
+	 */
+	const void* data() const
+	{
+		return m_data;
+	}
+
+	/**
+	 * \brief 文件的字节数
+	 * \return
+	 */
+	size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	// 映射的起始地址
+	const void* m_data = nullptr;
+
+	// 映射的字节数
+	size_t m_size = 0;
+
+	/**
+	 * \brief 解除映射
+	 */
+	void unmap();
+};
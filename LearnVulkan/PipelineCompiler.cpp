@@ -0,0 +1,424 @@
+#include "PipelineCompiler.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "CpuTrace.h"
+#include "Hash.h"
+
+uint64_t GraphicsPipelineState::hash() const
+{
+	uint64_t hash = hashValue(m_vertexShaderHash, 14695981039346656037ull);
+	hash = hashValue(m_fragmentShaderHash, hash);
+	hash = m_vertexSpecialization.hash(hash);
+	hash = m_fragmentSpecialization.hash(hash);
+	for (const auto& binding : m_vertexBindings)
+	{
+		hash = hashValue(binding, hash);
+	}
+	for (const auto& attribute : m_vertexAttributes)
+	{
+		hash = hashValue(attribute, hash);
+	}
+	hash = hashValue(m_topology, hash);
+	hash = hashValue(m_polygonMode, hash);
+	hash = hashValue(m_cullMode, hash);
+	hash = hashValue(m_frontFace, hash);
+	hash = hashValue(m_depthTestEnable, hash);
+	hash = hashValue(m_depthWriteEnable, hash);
+	hash = hashValue(m_depthCompareOp, hash);
+	hash = hashValue(m_blendEnable, hash);
+	hash = hashValue(m_colorWriteMask, hash);
+	hash = hashValue(m_colorFormat, hash);
+	hash = hashValue(m_layout, hash);
+	hash = hashValue(m_renderPass, hash);
+	hash = hashValue(m_subpass, hash);
+	hash = hashValue(m_extendedDynamicState, hash);
+	return hash;
+}
+
+GraphicsPipelineState GraphicsPipelineState::normalized() const
+{
+	GraphicsPipelineState state = *this;
+	if (!m_extendedDynamicState)
+	{
+		return state;
+	}
+
+	GraphicsPipelineState defaults;
+	state.m_cullMode = defaults.m_cullMode;
+	state.m_frontFace = defaults.m_frontFace;
+	state.m_depthTestEnable = defaults.m_depthTestEnable;
+	state.m_depthWriteEnable = defaults.m_depthWriteEnable;
+	state.m_depthCompareOp = defaults.m_depthCompareOp;
+
+	// 动态拓扑只能在同一类图元之间切换，管线里保留类别
+	switch (m_topology)
+	{
+	case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+		break;
+	case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+		state.m_topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+		break;
+	case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+		break;
+	default:
+		state.m_topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		break;
+	}
+	return state;
+}
+
+bool GraphicsPipelineState::operator==(const GraphicsPipelineState& other) const
+{
+	if (m_vertexBindings.size() != other.m_vertexBindings.size() || m_vertexAttributes.size() != other.m_vertexAttributes.size())
+	{
+		return false;
+	}
+
+	// 顶点输入描述都是没有填充的uint32_t字段，可以按字节比较
+	if (!m_vertexBindings.empty() &&
+		memcmp(m_vertexBindings.data(), other.m_vertexBindings.data(), m_vertexBindings.size() * sizeof(m_vertexBindings[0])) != 0)
+	{
+		return false;
+	}
+	if (!m_vertexAttributes.empty() &&
+		memcmp(m_vertexAttributes.data(), other.m_vertexAttributes.data(), m_vertexAttributes.size() * sizeof(m_vertexAttributes[0])) != 0)
+	{
+		return false;
+	}
+
+	return m_vertexShaderHash == other.m_vertexShaderHash && m_fragmentShaderHash == other.m_fragmentShaderHash &&
+		m_vertexSpecialization == other.m_vertexSpecialization && m_fragmentSpecialization == other.m_fragmentSpecialization &&
+		m_topology == other.m_topology &&
+		m_polygonMode == other.m_polygonMode && m_cullMode == other.m_cullMode && m_frontFace == other.m_frontFace &&
+		m_depthTestEnable == other.m_depthTestEnable && m_depthWriteEnable == other.m_depthWriteEnable &&
+		m_depthCompareOp == other.m_depthCompareOp && m_blendEnable == other.m_blendEnable &&
+		m_colorWriteMask == other.m_colorWriteMask && m_colorFormat == other.m_colorFormat &&
+		m_layout == other.m_layout && m_renderPass == other.m_renderPass && m_subpass == other.m_subpass &&
+		m_extendedDynamicState == other.m_extendedDynamicState;
+}
+
+VkPipeline buildGraphicsPipeline(VkDevice device, VkPipelineCache pipelineCache, const GraphicsPipelineState& state)
+{
+	VkSpecializationInfo vertexSpecialization = {};
+	VkSpecializationInfo fragmentSpecialization = {};
+	state.m_vertexSpecialization.fillInfo(vertexSpecialization);
+	state.m_fragmentSpecialization.fillInfo(fragmentSpecialization);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = state.m_vertexShader;
+	shaderStages[0].pName = "main";
+	shaderStages[0].pSpecializationInfo = state.m_vertexSpecialization.empty() ? nullptr : &vertexSpecialization;
+
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = state.m_fragmentShader;
+	shaderStages[1].pName = "main";
+	shaderStages[1].pSpecializationInfo = state.m_fragmentSpecialization.empty() ? nullptr : &fragmentSpecialization;
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(state.m_vertexBindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = state.m_vertexBindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.m_vertexAttributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = state.m_vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = state.m_topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// 视口和裁剪矩形在录制时设置，交换链大小改变不需要重新创建管线
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	if (state.m_extendedDynamicState)
+	{
+		dynamicStates.insert(dynamicStates.end(), {
+			VK_DYNAMIC_STATE_CULL_MODE_EXT,
+			VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+			VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+			VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+			VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+			VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT });
+	}
+
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = state.m_polygonMode;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = state.m_cullMode;
+	rasterizer.frontFace = state.m_frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = state.m_depthTestEnable;
+	depthStencil.depthWriteEnable = state.m_depthWriteEnable;
+	depthStencil.depthCompareOp = state.m_depthCompareOp;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = state.m_colorWriteMask;
+	colorBlendAttachment.blendEnable = state.m_blendEnable;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = state.m_layout;
+	pipelineInfo.renderPass = state.m_renderPass;
+	pipelineInfo.subpass = state.m_subpass;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+	return pipeline;
+}
+
+void PipelineCompiler::init(VkDevice device, VkPipelineCache pipelineCache, JobSystem& jobs)
+{
+	m_device = device;
+	m_pipelineCache = pipelineCache;
+	m_jobs = &jobs;
+}
+
+void PipelineCompiler::destroy()
+{
+	if (m_jobs == nullptr)
+	{
+		return;
+	}
+
+	waitIdle();
+	for (auto& entry : m_entries)
+	{
+		vkDestroyPipeline(m_device, entry->m_pipeline, nullptr);
+	}
+	m_entries.clear();
+	m_handles.clear();
+	m_jobs = nullptr;
+}
+
+bool PipelineCompiler::find(const GraphicsPipelineState& state, Handle& handle)
+{
+	m_requests++;
+	auto it = m_handles.find(state.normalized());
+	if (it == m_handles.end())
+	{
+		return false;
+	}
+
+	m_deduplicated++;
+	handle = it->second;
+	return true;
+}
+
+PipelineCompiler::Handle PipelineCompiler::request(const GraphicsPipelineState& state)
+{
+	Handle handle = 0;
+	if (find(state, handle))
+	{
+		return handle;
+	}
+
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	handle = static_cast<Handle>(m_entries.size());
+	m_entries.push_back(entry);
+	m_handles.emplace(state.normalized(), handle);
+
+	VkDevice device = m_device;
+	VkPipelineCache pipelineCache = m_pipelineCache;
+	m_jobs->run([this, entry, state, device, pipelineCache]()
+	{
+		CpuTraceScope traceScope("compile pipeline");
+
+		auto startTime = std::chrono::steady_clock::now();
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		try
+		{
+			pipeline = buildGraphicsPipeline(device, pipelineCache, state);
+		}
+		catch (const std::exception& e)
+		{
+			// 失败的请求一直保持未就绪，使用它的绘制继续回退
+			std::cerr << "pipeline compile failed: " << e.what() << std::endl;
+			return;
+		}
+		auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+		m_compileMicroseconds += static_cast<uint64_t>(microseconds);
+		m_compiled++;
+
+		std::lock_guard<std::mutex> lock(entry->m_mutex);
+		if (entry->m_abandoned)
+		{
+			// 从未被命令缓冲引用过，可以立即销毁
+			vkDestroyPipeline(device, pipeline, nullptr);
+			return;
+		}
+		entry->m_pipeline = pipeline;
+		entry->m_ready.store(true, std::memory_order_release);
+	}, &m_pendingCompiles);
+
+	return handle;
+}
+
+VkPipeline PipelineCompiler::compile(const GraphicsPipelineState& state)
+{
+	Handle handle = 0;
+	if (find(state, handle))
+	{
+		Entry& entry = *m_entries[handle];
+		if (!entry.m_ready.load(std::memory_order_acquire))
+		{
+			// 同样的管线正在后台编译，等它完成比再编译一次便宜
+			waitIdle();
+		}
+		if (!entry.m_ready.load(std::memory_order_acquire))
+		{
+			throw std::runtime_error("failed to create graphics pipeline!");
+		}
+		return entry.m_pipeline;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	VkPipeline pipeline = buildGraphicsPipeline(m_device, m_pipelineCache, state);
+	auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	m_compileMicroseconds += static_cast<uint64_t>(microseconds);
+	m_compiled++;
+
+	insert(state, pipeline);
+	return pipeline;
+}
+
+VkPipeline PipelineCompiler::adopt(const GraphicsPipelineState& state, VkPipeline pipeline)
+{
+	Handle handle = 0;
+	if (!find(state, handle))
+	{
+		insert(state, pipeline);
+		return pipeline;
+	}
+
+	std::shared_ptr<Entry>& existing = m_entries[handle];
+	if (existing->m_ready.load(std::memory_order_acquire))
+	{
+		// 表中已经有状态相同的管线，传入的这条用不上
+		vkDestroyPipeline(m_device, pipeline, nullptr);
+		return existing->m_pipeline;
+	}
+
+	// 同样的管线还在后台编译或者编译失败了，由传入的管线顶替，编译结果完成后直接销毁
+	{
+		std::lock_guard<std::mutex> lock(existing->m_mutex);
+		existing->m_abandoned = true;
+	}
+	existing = std::make_shared<Entry>();
+	existing->m_pipeline = pipeline;
+	existing->m_ready.store(true, std::memory_order_release);
+	return pipeline;
+}
+
+void PipelineCompiler::insert(const GraphicsPipelineState& state, VkPipeline pipeline)
+{
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	entry->m_pipeline = pipeline;
+	entry->m_ready.store(true, std::memory_order_release);
+	m_handles.emplace(state.normalized(), static_cast<Handle>(m_entries.size()));
+	m_entries.push_back(entry);
+}
+
+VkPipeline PipelineCompiler::get(Handle handle)
+{
+	Entry& entry = *m_entries[handle];
+	if (entry.m_ready.load(std::memory_order_acquire))
+	{
+		m_hits.fetch_add(1, std::memory_order_relaxed);
+		return entry.m_pipeline;
+	}
+
+	m_misses.fetch_add(1, std::memory_order_relaxed);
+	m_frameMisses.fetch_add(1, std::memory_order_relaxed);
+	return VK_NULL_HANDLE;
+}
+
+void PipelineCompiler::endFrame()
+{
+	if (m_frameMisses.exchange(0) != 0)
+	{
+		m_fallbackFrames++;
+	}
+}
+
+void PipelineCompiler::reset(const std::function<void(VkPipeline)>& retire)
+{
+	for (auto& entry : m_entries)
+	{
+		std::lock_guard<std::mutex> lock(entry->m_mutex);
+		entry->m_abandoned = true;
+		if (entry->m_pipeline != VK_NULL_HANDLE)
+		{
+			retire(entry->m_pipeline);
+			entry->m_pipeline = VK_NULL_HANDLE;
+		}
+	}
+	m_entries.clear();
+	m_handles.clear();
+}
+
+void PipelineCompiler::waitIdle()
+{
+	m_jobs->wait(m_pendingCompiles);
+}
+
+double PipelineCompiler::getCompileMilliseconds() const
+{
+	return m_compileMicroseconds.load() / 1000.0;
+}
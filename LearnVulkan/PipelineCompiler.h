@@ -0,0 +1,277 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.h"
+#include "ShaderVariants.h"
+
+/**
+ * \brief 创建一条图形管线需要的全部状态，按值保存，可以交给任务线程使用
+ *
+ * 同时也是管线的键：状态相同的请求得到同一条管线。着色器按代码的哈希比较，
+ * 模块句柄只用于创建，不参与比较。
+ */
+struct GraphicsPipelineState
+{
+	VkShaderModule m_vertexShader = VK_NULL_HANDLE;
+	VkShaderModule m_fragmentShader = VK_NULL_HANDLE;
+
+	// 着色器SPIR-V代码的哈希
+	uint64_t m_vertexShaderHash = 0;
+	uint64_t m_fragmentShaderHash = 0;
+
+	// 各阶段的特化常量，取值不同的变体是不同的管线
+	SpecializationConstants m_vertexSpecialization;
+	SpecializationConstants m_fragmentSpecialization;
+
+	std::vector<VkVertexInputBindingDescription> m_vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> m_vertexAttributes;
+
+	VkPrimitiveTopology m_topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPolygonMode m_polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags m_cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace m_frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	// 渲染流程没有深度附件时不起作用
+	VkBool32 m_depthTestEnable = VK_FALSE;
+	VkBool32 m_depthWriteEnable = VK_FALSE;
+	VkCompareOp m_depthCompareOp = VK_COMPARE_OP_LESS;
+
+	// 开启时使用标准的alpha混合
+	VkBool32 m_blendEnable = VK_FALSE;
+	VkColorComponentFlags m_colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	// 颜色附件格式，格式不同的渲染流程不兼容
+	VkFormat m_colorFormat = VK_FORMAT_UNDEFINED;
+
+	VkPipelineLayout m_layout = VK_NULL_HANDLE;
+	VkRenderPass m_renderPass = VK_NULL_HANDLE;
+	uint32_t m_subpass = 0;
+
+	// 使用VK_EXT_extended_dynamic_state：剔除方式、正面朝向、图元拓扑和深度测试在录制时设置。
+	// 视口和裁剪矩形总是动态的
+	bool m_extendedDynamicState = false;
+
+	/**
+	 * \brief 把由动态状态决定的字段换成固定值，只差这些字段的状态得到同一条管线
+	 * \return
+	 */
+	GraphicsPipelineState normalized() const;
+
+	/**
+	 * \brief 所有参与比较的字段的哈希
+	 * \return
+	 */
+	uint64_t hash() const;
+
+	bool operator==(const GraphicsPipelineState& other) const;
+};
+
+/**
+ * \brief 供无序容器使用的哈希函数对象
+ */
+struct GraphicsPipelineStateHash
+{
+	size_t operator()(const GraphicsPipelineState& state) const
+	{
+		return static_cast<size_t>(state.hash());
+	}
+};
+
+/**
+ * \brief 按状态同步创建一条图形管线
+ * \param device
+ * \param pipelineCache 可以为VK_NULL_HANDLE
+ * \param state
+ * \return
+ */
+VkPipeline buildGraphicsPipeline(VkDevice device, VkPipelineCache pipelineCache, const GraphicsPipelineState& state);
+
+/**
+ * \brief 在任务线程上异步编译图形管线，并按状态去重
+ *
+ * 所有管线按归一化之后的GraphicsPipelineState记录在表中，状态相同的请求直接返回已有的句柄，
+ * 不会让驱动重复编译。新的请求立即返回句柄，vkCreateGraphicsPipelines在任务线程上针对共享的管线缓存执行
+ * （管线缓存本身是线程安全的）。录制时用句柄查询，管线还没编译好时由调用者
+ * 跳过绘制或者改用通用管线，不会在渲染线程上等待编译。
+ */
+class PipelineCompiler
+{
+public:
+	typedef uint32_t Handle;
+
+	PipelineCompiler() = default;
+
+	PipelineCompiler(const PipelineCompiler&) = delete;
+	PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+	void init(VkDevice device, VkPipelineCache pipelineCache, JobSystem& jobs);
+
+	/**
+	 * \brief 等待所有编译完成并销毁编译出的管线，调用前设备应该已经空闲
+	 */
+	void destroy();
+
+	/**
+	 * \brief 提交一个编译请求，只能在主线程调用
+	 * \param state 着色器模块必须保持有效，直到编译完成
+	 * \return 状态相同的管线已经请求过时返回它的句柄
+	 */
+	Handle request(const GraphicsPipelineState& state);
+
+	/**
+	 * \brief 在当前线程上同步创建管线，已经有状态相同的管线时直接返回，只能在主线程调用
+	 * \param state
+	 * \return 由编译器持有，随reset或destroy一起释放
+	 */
+	VkPipeline compile(const GraphicsPipelineState& state);
+
+	/**
+	 * \brief 把在别处创建好的管线放进表中，只能在主线程调用
+	 *
+	 * 用于着色器热重载：新管线在任务线程上创建，帧与帧之间再一次性换进来。
+	 * \param state 创建管线时使用的状态
+	 * \param pipeline 所有权交给编译器，已经有状态相同的管线时被销毁
+	 * \return 表中这个状态对应的管线
+	 */
+	VkPipeline adopt(const GraphicsPipelineState& state, VkPipeline pipeline);
+
+	/**
+	 * \brief 查询编译结果并计入命中或未命中，可以在多个录制线程上同时调用
+	 * \param handle
+	 * \return 还没编译好或编译失败时返回VK_NULL_HANDLE
+	 */
+	VkPipeline get(Handle handle);
+
+	/**
+	 * \brief 一帧录制结束，这一帧有未命中时计入一次回退帧
+	 */
+	void endFrame();
+
+	/**
+	 * \brief 放弃表中所有管线，已经编译好的交给retire，仍在编译的在完成后直接销毁
+	 *
+	 * 用于渲染流程或视口改变后整体重新请求，不等待正在进行的编译。
+	 * \param retire 接收管线的所有权，通常放进延迟删除队列
+	 */
+	void reset(const std::function<void(VkPipeline)>& retire);
+
+	/**
+	 * \brief 等待所有已提交的编译完成
+	 */
+	void waitIdle();
+
+	uint64_t getRequestCount() const
+	{
+		return m_requests;
+	}
+
+	/**
+	 * \brief 命中已有管线而没有重新编译的请求数
+	 * \return
+	 */
+	uint64_t getDeduplicatedCount() const
+	{
+		return m_deduplicated;
+	}
+
+	/**
+	 * \brief 当前表中不同管线的数量
+	 * \return
+	 */
+	size_t getPipelineCount() const
+	{
+		return m_entries.size();
+	}
+
+	uint64_t getCompiledCount() const
+	{
+		return m_compiled.load();
+	}
+
+	uint64_t getHitCount() const
+	{
+		return m_hits.load();
+	}
+
+	uint64_t getMissCount() const
+	{
+		return m_misses.load();
+	}
+
+	uint64_t getFallbackFrameCount() const
+	{
+		return m_fallbackFrames;
+	}
+
+	/**
+	 * \brief 所有编译耗时的总和，单位毫秒
+	 * \return
+	 */
+	double getCompileMilliseconds() const;
+
+private:
+	/**
+	 * \brief 一个编译请求，编译任务持有它的引用，放弃之后也能安全完成
+	 */
+	struct Entry
+	{
+		std::mutex m_mutex;
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+		// 编译完成后置位，录制线程无锁读取
+		std::atomic<bool> m_ready{ false };
+
+		// 已经被reset放弃，编译完成后直接销毁
+		bool m_abandoned = false;
+	};
+
+	VkDevice m_device = VK_NULL_HANDLE;
+	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+	JobSystem* m_jobs = nullptr;
+
+	std::vector<std::shared_ptr<Entry>> m_entries;
+
+	// 管线状态到句柄的映射
+	std::unordered_map<GraphicsPipelineState, Handle, GraphicsPipelineStateHash> m_handles;
+
+	uint64_t m_requests = 0;
+	uint64_t m_deduplicated = 0;
+
+	// 所有已提交且尚未完成的编译任务
+	JobCounter m_pendingCompiles;
+
+	std::atomic<uint64_t> m_compiled{ 0 };
+	std::atomic<uint64_t> m_compileMicroseconds{ 0 };
+	std::atomic<uint64_t> m_hits{ 0 };
+	std::atomic<uint64_t> m_misses{ 0 };
+
+	// 当前帧的未命中次数
+	std::atomic<uint32_t> m_frameMisses{ 0 };
+
+	uint64_t m_fallbackFrames = 0;
+
+	/**
+	 * \brief 查找状态相同的管线并计数
+	 * \param state
+	 * \param handle
+	 * \return
+	 */
+	bool find(const GraphicsPipelineState& state, Handle& handle);
+
+	/**
+	 * \brief 为已经创建好的管线添加一个新的表项
+	 * \param state
+	 * \param pipeline
+	 */
+	void insert(const GraphicsPipelineState& state, VkPipeline pipeline);
+};
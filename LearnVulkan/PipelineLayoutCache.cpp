@@ -0,0 +1,248 @@
+#include "PipelineLayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "Hash.h"
+
+uint64_t DescriptorSetLayoutKey::hash() const
+{
+	uint64_t seed = hashValue(m_bindings.size(), 14695981039346656037ull);
+	for (const auto& binding : m_bindings)
+	{
+		seed = hashValue(binding.binding, seed);
+		seed = hashValue(binding.descriptorType, seed);
+		seed = hashValue(binding.descriptorCount, seed);
+		seed = hashValue(binding.stageFlags, seed);
+	}
+	return seed;
+}
+
+bool DescriptorSetLayoutKey::operator==(const DescriptorSetLayoutKey& other) const
+{
+	if (m_bindings.size() != other.m_bindings.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < m_bindings.size(); i++)
+	{
+		const VkDescriptorSetLayoutBinding& a = m_bindings[i];
+		const VkDescriptorSetLayoutBinding& b = other.m_bindings[i];
+		if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+			a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t PipelineLayoutKey::hash() const
+{
+	uint64_t seed = hashValue(m_setLayouts.size(), 14695981039346656037ull);
+	for (auto setLayout : m_setLayouts)
+	{
+		seed = hashValue(setLayout, seed);
+	}
+	for (const auto& range : m_pushConstantRanges)
+	{
+		seed = hashValue(range, seed);
+	}
+	return seed;
+}
+
+bool PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const
+{
+	if (m_setLayouts != other.m_setLayouts || m_pushConstantRanges.size() != other.m_pushConstantRanges.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < m_pushConstantRanges.size(); i++)
+	{
+		const VkPushConstantRange& a = m_pushConstantRanges[i];
+		const VkPushConstantRange& b = other.m_pushConstantRanges[i];
+		if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void PipelineLayoutCache::init(VkDevice device)
+{
+	m_device = device;
+}
+
+void PipelineLayoutCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& entry : m_pipelineLayouts)
+	{
+		vkDestroyPipelineLayout(m_device, entry.second, nullptr);
+	}
+	for (auto& entry : m_setLayouts)
+	{
+		vkDestroyDescriptorSetLayout(m_device, entry.second, nullptr);
+	}
+	m_pipelineLayouts.clear();
+	m_setLayouts.clear();
+	m_reservedSets.clear();
+}
+
+void PipelineLayoutCache::reserveSet(uint32_t set, VkDescriptorSetLayout layout)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_reservedSets[set] = layout;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings)
+{
+	std::sort(bindings.begin(), bindings.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+	DescriptorSetLayoutKey key;
+	key.m_bindings = std::move(bindings);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_setLayouts.find(key);
+	if (it != m_setLayouts.end())
+	{
+		return it->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(key.m_bindings.size());
+	layoutInfo.pBindings = key.m_bindings.data();
+
+	VkDescriptorSetLayout setLayout;
+	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor set layout!");
+	}
+
+	m_setLayouts.emplace(std::move(key), setLayout);
+	return setLayout;
+}
+
+VkPipelineLayout PipelineLayoutCache::getPipelineLayout(const PipelineLayoutKey& key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_pipelineLayouts.find(key);
+	if (it != m_pipelineLayouts.end())
+	{
+		return it->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(key.m_setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = key.m_setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(key.m_pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = key.m_pushConstantRanges.data();
+
+	VkPipelineLayout pipelineLayout;
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	m_pipelineLayouts.emplace(key, pipelineLayout);
+	return pipelineLayout;
+}
+
+VkPipelineLayout PipelineLayoutCache::getPipelineLayout(const std::vector<const ShaderReflection*>& stages)
+{
+	// 集合 -> 绑定号 -> 绑定
+	std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> sets;
+
+	VkPushConstantRange pushConstantRange = {};
+	uint32_t pushConstantEnd = 0;
+
+	// 初始化之后不再修改，不需要加锁读取
+	uint32_t setCount = m_reservedSets.empty() ? 0 : m_reservedSets.rbegin()->first + 1;
+
+	for (const ShaderReflection* stage : stages)
+	{
+		for (const auto& descriptor : stage->m_descriptorBindings)
+		{
+			if (m_reservedSets.count(descriptor.m_set) != 0)
+			{
+				continue;
+			}
+
+			std::string location = "set " + std::to_string(descriptor.m_set) + " binding " + std::to_string(descriptor.m_binding);
+			if (descriptor.m_count == 0)
+			{
+				throw std::runtime_error("runtime-sized descriptor array at " + location + " is not supported!");
+			}
+
+			auto& bindings = sets[descriptor.m_set];
+			auto it = bindings.find(descriptor.m_binding);
+			if (it == bindings.end())
+			{
+				VkDescriptorSetLayoutBinding binding = {};
+				binding.binding = descriptor.m_binding;
+				binding.descriptorType = descriptor.m_type;
+				binding.descriptorCount = descriptor.m_count;
+				binding.stageFlags = stage->m_stage;
+				bindings.emplace(descriptor.m_binding, binding);
+			}
+			else if (it->second.descriptorType != descriptor.m_type || it->second.descriptorCount != descriptor.m_count)
+			{
+				throw std::runtime_error("shader stages disagree on " + location + "!");
+			}
+			else
+			{
+				it->second.stageFlags |= stage->m_stage;
+			}
+		}
+
+		if (stage->m_pushConstantSize != 0)
+		{
+			uint32_t end = stage->m_pushConstantOffset + stage->m_pushConstantSize;
+			pushConstantRange.offset = pushConstantRange.stageFlags == 0 ? stage->m_pushConstantOffset
+				: std::min(pushConstantRange.offset, stage->m_pushConstantOffset);
+			pushConstantRange.stageFlags |= stage->m_stage;
+			pushConstantEnd = std::max(pushConstantEnd, end);
+		}
+	}
+
+	PipelineLayoutKey key;
+	if (!sets.empty())
+	{
+		setCount = std::max(setCount, sets.rbegin()->first + 1);
+	}
+	for (uint32_t set = 0; set < setCount; set++)
+	{
+		auto reserved = m_reservedSets.find(set);
+		if (reserved != m_reservedSets.end())
+		{
+			key.m_setLayouts.push_back(reserved->second);
+			continue;
+		}
+
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		auto it = sets.find(set);
+		if (it != sets.end())
+		{
+			for (const auto& binding : it->second)
+			{
+				bindings.push_back(binding.second);
+			}
+		}
+		key.m_setLayouts.push_back(getDescriptorSetLayout(bindings));
+	}
+
+	if (pushConstantRange.stageFlags != 0)
+	{
+		pushConstantRange.size = pushConstantEnd - pushConstantRange.offset;
+		key.m_pushConstantRanges.push_back(pushConstantRange);
+	}
+
+	return getPipelineLayout(key);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderReflection.h"
+
+/**
+ * \brief 描述符集布局的键：按binding递增排列的绑定
+ */
+struct DescriptorSetLayoutKey
+{
+	std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+
+	uint64_t hash() const;
+
+	bool operator==(const DescriptorSetLayoutKey& other) const;
+};
+
+/**
+ * \brief 管线布局的键：各个集合的布局和推送常量范围
+ */
+struct PipelineLayoutKey
+{
+	std::vector<VkDescriptorSetLayout> m_setLayouts;
+	std::vector<VkPushConstantRange> m_pushConstantRanges;
+
+	uint64_t hash() const;
+
+	bool operator==(const PipelineLayoutKey& other) const;
+};
+
+/**
+ * \brief 供无序容器使用的哈希函数对象
+ */
+struct LayoutKeyHash
+{
+	template<typename Key>
+	size_t operator()(const Key& key) const
+	{
+		return static_cast<size_t>(key.hash());
+	}
+};
+
+/**
+ * \brief 按内容去重的描述符集布局和管线布局
+ *
+ * 内容相同的布局只创建一次并返回同一个句柄，前面几个集合布局相同的两个管线布局
+ * 对这些集合是兼容的，切换管线之后已经绑定的描述符集仍然有效。
+ * 布局由缓存持有，直到destroy才销毁，可以在多个线程上同时查询。
+ */
+class PipelineLayoutCache
+{
+public:
+	PipelineLayoutCache() = default;
+
+	PipelineLayoutCache(const PipelineLayoutCache&) = delete;
+	PipelineLayoutCache& operator=(const PipelineLayoutCache&) = delete;
+
+	void init(VkDevice device);
+
+	/**
+	 * \brief 销毁所有布局，调用前不应再有使用它们的管线正在创建
+	 */
+	void destroy();
+
+	/**
+	 * \brief 取得一个描述符集布局，没有时创建
+	 * \param bindings 顺序不影响结果
+	 * \return
+	 */
+	VkDescriptorSetLayout getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+
+	/**
+	 * \brief 取得一个管线布局，没有时创建
+	 * \param key
+	 * \return
+	 */
+	VkPipelineLayout getPipelineLayout(const PipelineLayoutKey& key);
+
+	/**
+	 * \brief 合并一条管线各个着色器阶段的反射结果，取得它的管线布局
+	 *
+	 * 同一个绑定在多个阶段中出现时合并阶段标志，类型或数量不一致时抛出异常。
+	 * 中间没有用到的集合使用空的布局，推送常量合并为一个覆盖所有阶段的范围。
+	 * \param stages
+	 * \return
+	 */
+	VkPipelineLayout getPipelineLayout(const std::vector<const ShaderReflection*>& stages);
+
+	/**
+	 * \brief 保留一个集合，由反射生成的所有管线布局都在这个集合使用给定的布局
+	 *
+	 * 着色器在保留集合中的声明不参与生成布局，可以使用运行时大小的数组。
+	 * 必须在第一次取得管线布局之前调用。
+	 * \param set
+	 * \param layout 由调用者持有，比缓存活得更久
+	 */
+	void reserveSet(uint32_t set, VkDescriptorSetLayout layout);
+
+	size_t getDescriptorSetLayoutCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_setLayouts.size();
+	}
+
+	size_t getPipelineLayoutCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pipelineLayouts.size();
+	}
+
+private:
+	VkDevice m_device = VK_NULL_HANDLE;
+
+	mutable std::mutex m_mutex;
+
+	std::unordered_map<DescriptorSetLayoutKey, VkDescriptorSetLayout, LayoutKeyHash> m_setLayouts;
+	std::unordered_map<PipelineLayoutKey, VkPipelineLayout, LayoutKeyHash> m_pipelineLayouts;
+
+	// 保留的集合和它们的布局
+	std::map<uint32_t, VkDescriptorSetLayout> m_reservedSets;
+};
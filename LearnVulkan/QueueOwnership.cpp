@@ -0,0 +1,77 @@
+#include "QueueOwnership.h"
+
+void releaseBufferOwnership(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+	uint32_t srcFamily, uint32_t dstFamily, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess)
+{
+	if (srcFamily == dstFamily)
+	{
+		return;
+	}
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+
+	// 释放屏障的目标阶段会被忽略，可见性由目标队列上的获取屏障负责
+	vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+VkBufferMemoryBarrier makeBufferAcquireBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+	uint32_t srcFamily, uint32_t dstFamily, VkAccessFlags dstAccess)
+{
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	return barrier;
+}
+
+void releaseImageOwnership(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& subresourceRange,
+	VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily,
+	VkPipelineStageFlags srcStage, VkAccessFlags srcAccess)
+{
+	if (srcFamily == dstFamily)
+	{
+		return;
+	}
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
+	barrier.image = image;
+	barrier.subresourceRange = subresourceRange;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+VkImageMemoryBarrier makeImageAcquireBarrier(VkImage image, const VkImageSubresourceRange& subresourceRange,
+	VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily, VkAccessFlags dstAccess)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
+	barrier.image = image;
+	barrier.subresourceRange = subresourceRange;
+	return barrier;
+}
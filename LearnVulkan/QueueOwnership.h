@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// 资源在使用独占共享模式时，从一个队列族交给另一个队列族要成对地记录释放和获取屏障：
+// 释放屏障在源队列上提交，获取屏障在目标队列上提交，两者的队列族和布局转换必须一致，
+// 之间通过信号量保证先后顺序。源和目标是同一个队列族时不需要转移所有权。
+
+/**
+ * \brief 在源队列上释放缓冲一段范围的队列族所有权，需要与目标队列上makeBufferAcquireBarrier生成的屏障配对
+ * \param commandBuffer 在源队列族上提交的命令缓冲
+ * \param buffer
+ * \param offset
+ * \param size
+ * \param srcFamily
+ * \param dstFamily
+ * \param srcStage 源队列上最后访问缓冲的阶段
+ * \param srcAccess 源队列上最后访问缓冲的方式
+ */
+void releaseBufferOwnership(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+	uint32_t srcFamily, uint32_t dstFamily, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess);
+
+/**
+ * \brief 生成在目标队列上获取缓冲所有权的屏障，多个屏障可以合并到一次vkCmdPipelineBarrier中记录
+ * \param buffer
+ * \param offset
+ * \param size
+ * \param srcFamily
+ * \param dstFamily
+ * \param dstAccess 目标队列上第一次访问缓冲的方式
+ * \return
+ */
+VkBufferMemoryBarrier makeBufferAcquireBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+	uint32_t srcFamily, uint32_t dstFamily, VkAccessFlags dstAccess);
+
+/**
+ * \brief 在源队列上释放图像的队列族所有权，可以同时进行布局转换
+ * \param commandBuffer 在源队列族上提交的命令缓冲
+ * \param image
+ * \param subresourceRange
+ * \param oldLayout
+ * \param newLayout 与目标队列上的获取屏障必须一致
+ * \param srcFamily
+ * \param dstFamily
+ * \param srcStage
+ * \param srcAccess
+ */
+void releaseImageOwnership(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& subresourceRange,
+	VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily,
+	VkPipelineStageFlags srcStage, VkAccessFlags srcAccess);
+
+/**
+ * \brief 生成在目标队列上获取图像所有权的屏障
+ * \param image
+ * \param subresourceRange
+ * \param oldLayout 与源队列上的释放屏障必须一致
+ * \param newLayout
+ * \param srcFamily
+ * \param dstFamily
+ * \param dstAccess
+ * \return
+ */
+VkImageMemoryBarrier makeImageAcquireBarrier(VkImage image, const VkImageSubresourceRange& subresourceRange,
+	VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily, VkAccessFlags dstAccess);
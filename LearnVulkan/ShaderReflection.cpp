@@ -0,0 +1,708 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	// SPIR-V规范中用到的编号，没有引入spirv.h
+	const uint32_t SPIRV_MAGIC = 0x07230203;
+
+	enum SpirvOp : uint32_t
+	{
+		OpName = 5,
+		OpEntryPoint = 15,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpSpecConstantTrue = 48,
+		OpSpecConstantFalse = 49,
+		OpSpecConstant = 50,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72,
+	};
+
+	enum SpirvDecoration : uint32_t
+	{
+		DecorationSpecId = 1,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35,
+	};
+
+	enum SpirvStorageClass : uint32_t
+	{
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassOutput = 3,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12,
+	};
+
+	// OpTypeImage的Dim
+	const uint32_t DIM_BUFFER = 5;
+	const uint32_t DIM_SUBPASS_DATA = 6;
+
+	// 表示没有这项修饰
+	const uint32_t NOT_DECORATED = UINT32_MAX;
+
+	// 计算类型大小时允许的嵌套层数，防止损坏的模块中互相引用的类型无限递归
+	const uint32_t MAX_TYPE_DEPTH = 64;
+
+	/**
+	 * \brief 一个id上的修饰
+	 */
+	struct Decorations
+	{
+		uint32_t m_location = NOT_DECORATED;
+		uint32_t m_binding = NOT_DECORATED;
+		uint32_t m_set = NOT_DECORATED;
+		uint32_t m_specId = NOT_DECORATED;
+		uint32_t m_arrayStride = NOT_DECORATED;
+		bool m_builtIn = false;
+		bool m_bufferBlock = false;
+	};
+
+	/**
+	 * \brief 结构体一个成员上的修饰
+	 */
+	struct MemberDecorations
+	{
+		uint32_t m_offset = 0;
+		uint32_t m_matrixStride = NOT_DECORATED;
+		bool m_builtIn = false;
+	};
+
+	/**
+	 * \brief 定义一个id的指令，只保存类型、常量和变量
+	 */
+	struct Definition
+	{
+		uint32_t m_opcode = 0;
+
+		// 指令的操作数，不包括第一个字
+		std::vector<uint32_t> m_operands;
+	};
+
+	/**
+	 * \brief 按id索引的SPIR-V模块
+	 */
+	class SpirvModule
+	{
+	public:
+		SpirvModule(const void* code, size_t size);
+
+		ShaderReflection reflect() const;
+
+	private:
+		std::vector<std::string> m_names;
+		std::vector<Decorations> m_decorations;
+		std::vector<std::vector<MemberDecorations>> m_memberDecorations;
+		std::vector<Definition> m_definitions;
+
+		// 按出现顺序排列的变量和特化常量
+		std::vector<uint32_t> m_variables;
+		std::vector<uint32_t> m_specConstants;
+
+		// 第一个入口点
+		uint32_t m_executionModel = UINT32_MAX;
+		std::string m_entryPoint;
+		std::vector<uint32_t> m_interface;
+
+		const Definition& getDefinition(uint32_t id, uint32_t opcode) const;
+
+		const Definition& getType(uint32_t id) const
+		{
+			return getDefinition(id, 0);
+		}
+
+		bool hasBuiltInMember(uint32_t structId) const;
+
+		uint32_t getConstant(uint32_t id) const;
+
+		uint32_t getTypeSize(uint32_t typeId, uint32_t matrixStride, uint32_t depth = 0) const;
+
+		VkFormat getFormat(uint32_t typeId) const;
+
+		VkDescriptorType getDescriptorType(uint32_t typeId, uint32_t storageClass) const;
+
+		void addInterfaceVariable(uint32_t variable, uint32_t typeId, std::vector<ShaderInterfaceVariable>& variables) const;
+	};
+
+	[[noreturn]] void fail(const std::string& reason)
+	{
+		throw std::runtime_error("failed to reflect shader: " + reason + "!");
+	}
+
+	/**
+	 * \brief 保存的指令至少需要的操作数个数，之后读取操作数时不再检查
+	 * \param opcode
+	 * \return
+	 */
+	size_t getMinOperandCount(uint32_t opcode)
+	{
+		switch (opcode)
+		{
+		case OpTypeBool:
+		case OpTypeSampler:
+		case OpTypeStruct:
+			return 1;
+		case OpTypeFloat:
+		case OpTypeSampledImage:
+		case OpTypeRuntimeArray:
+		case OpSpecConstantTrue:
+		case OpSpecConstantFalse:
+			return 2;
+		case OpTypeImage:
+			return 8;
+		default:
+			// OpTypeInt、OpTypeVector、OpTypeMatrix、OpTypeArray、OpTypePointer、OpConstant、OpSpecConstant、OpVariable
+			return 3;
+		}
+	}
+
+	/**
+	 * \brief 读取以0结尾、按字打包的字符串
+	 * \param words
+	 * \param count 可用的字数
+	 * \param used 字符串占用的字数
+	 * \return
+	 */
+	std::string readString(const uint32_t* words, size_t count, size_t& used)
+	{
+		std::string text;
+		for (used = 0; used < count; used++)
+		{
+			for (uint32_t byte = 0; byte < 4; byte++)
+			{
+				char c = static_cast<char>((words[used] >> (byte * 8)) & 0xFF);
+				if (c == '\0')
+				{
+					used++;
+					return text;
+				}
+				text += c;
+			}
+		}
+		fail("unterminated string");
+	}
+
+	SpirvModule::SpirvModule(const void* code, size_t size)
+	{
+		if (size % 4 != 0 || size < 20)
+		{
+			fail("invalid size");
+		}
+
+		const uint32_t* words = static_cast<const uint32_t*>(code);
+		size_t wordCount = size / 4;
+		if (words[0] != SPIRV_MAGIC)
+		{
+			fail("invalid magic number");
+		}
+
+		// 每个id至少要由一条指令定义，上限超过字数的模块一定是损坏的，不按它分配内存
+		uint32_t bound = words[3];
+		if (bound > wordCount)
+		{
+			fail("id bound exceeds module size");
+		}
+		m_names.resize(bound);
+		m_decorations.resize(bound);
+		m_memberDecorations.resize(bound);
+		m_definitions.resize(bound);
+
+		auto checkId = [bound](uint32_t id)
+		{
+			if (id >= bound)
+			{
+				fail("id out of range");
+			}
+			return id;
+		};
+
+		for (size_t offset = 5; offset < wordCount;)
+		{
+			uint32_t opcode = words[offset] & 0xFFFF;
+			uint32_t length = words[offset] >> 16;
+			if (length == 0 || offset + length > wordCount)
+			{
+				fail("truncated instruction");
+			}
+
+			const uint32_t* operands = words + offset + 1;
+			size_t operandCount = length - 1;
+			offset += length;
+
+			switch (opcode)
+			{
+			case OpName:
+				if (operandCount >= 2)
+				{
+					size_t used = 0;
+					m_names[checkId(operands[0])] = readString(operands + 1, operandCount - 1, used);
+				}
+				break;
+
+			case OpEntryPoint:
+				if (m_executionModel == UINT32_MAX && operandCount >= 3)
+				{
+					size_t used = 0;
+					m_executionModel = operands[0];
+					m_entryPoint = readString(operands + 2, operandCount - 2, used);
+					m_interface.assign(operands + 2 + used, operands + operandCount);
+				}
+				break;
+
+			case OpDecorate:
+				if (operandCount >= 2)
+				{
+					Decorations& decorations = m_decorations[checkId(operands[0])];
+					uint32_t literal = operandCount >= 3 ? operands[2] : 0;
+					switch (operands[1])
+					{
+					case DecorationSpecId: decorations.m_specId = literal; break;
+					case DecorationBufferBlock: decorations.m_bufferBlock = true; break;
+					case DecorationArrayStride: decorations.m_arrayStride = literal; break;
+					case DecorationBuiltIn: decorations.m_builtIn = true; break;
+					case DecorationLocation: decorations.m_location = literal; break;
+					case DecorationBinding: decorations.m_binding = literal; break;
+					case DecorationDescriptorSet: decorations.m_set = literal; break;
+					default: break;
+					}
+				}
+				break;
+
+			case OpMemberDecorate:
+				if (operandCount >= 3)
+				{
+					std::vector<MemberDecorations>& members = m_memberDecorations[checkId(operands[0])];
+					if (operands[1] >= wordCount)
+					{
+						fail("member index out of range");
+					}
+					if (members.size() <= operands[1])
+					{
+						members.resize(operands[1] + 1);
+					}
+
+					MemberDecorations& member = members[operands[1]];
+					uint32_t literal = operandCount >= 4 ? operands[3] : 0;
+					switch (operands[2])
+					{
+					case DecorationOffset: member.m_offset = literal; break;
+					case DecorationMatrixStride: member.m_matrixStride = literal; break;
+					case DecorationBuiltIn: member.m_builtIn = true; break;
+					default: break;
+					}
+				}
+				break;
+
+			case OpTypeBool:
+			case OpTypeInt:
+			case OpTypeFloat:
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeImage:
+			case OpTypeSampler:
+			case OpTypeSampledImage:
+			case OpTypeArray:
+			case OpTypeRuntimeArray:
+			case OpTypeStruct:
+			case OpTypePointer:
+				if (operandCount < getMinOperandCount(opcode))
+				{
+					fail("too few operands for opcode " + std::to_string(opcode));
+				}
+				else
+				{
+					Definition& definition = m_definitions[checkId(operands[0])];
+					definition.m_opcode = opcode;
+					definition.m_operands.assign(operands, operands + operandCount);
+				}
+				break;
+
+			case OpConstant:
+			case OpSpecConstantTrue:
+			case OpSpecConstantFalse:
+			case OpSpecConstant:
+			case OpVariable:
+				if (operandCount < getMinOperandCount(opcode))
+				{
+					fail("too few operands for opcode " + std::to_string(opcode));
+				}
+				else
+				{
+					Definition& definition = m_definitions[checkId(operands[1])];
+					definition.m_opcode = opcode;
+					definition.m_operands.assign(operands, operands + operandCount);
+					if (opcode == OpVariable)
+					{
+						m_variables.push_back(operands[1]);
+					}
+					else if (opcode != OpConstant)
+					{
+						m_specConstants.push_back(operands[1]);
+					}
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		if (m_executionModel == UINT32_MAX)
+		{
+			fail("no entry point");
+		}
+	}
+
+	const Definition& SpirvModule::getDefinition(uint32_t id, uint32_t opcode) const
+	{
+		if (id >= m_definitions.size() || m_definitions[id].m_opcode == 0 ||
+			(opcode != 0 && m_definitions[id].m_opcode != opcode))
+		{
+			fail("unexpected definition of %" + std::to_string(id));
+		}
+		return m_definitions[id];
+	}
+
+	bool SpirvModule::hasBuiltInMember(uint32_t structId) const
+	{
+		for (const auto& member : m_memberDecorations[structId])
+		{
+			if (member.m_builtIn)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint32_t SpirvModule::getConstant(uint32_t id) const
+	{
+		return getDefinition(id, OpConstant).m_operands[2];
+	}
+
+	uint32_t SpirvModule::getTypeSize(uint32_t typeId, uint32_t matrixStride, uint32_t depth) const
+	{
+		if (depth > MAX_TYPE_DEPTH)
+		{
+			fail("type %" + std::to_string(typeId) + " is nested too deeply");
+		}
+
+		const Definition& type = getType(typeId);
+		const std::vector<uint32_t>& operands = type.m_operands;
+		switch (type.m_opcode)
+		{
+		case OpTypeBool:
+			// 布尔值在块中按32位存放
+			return 4;
+
+		case OpTypeInt:
+		case OpTypeFloat:
+			return operands[1] / 8;
+
+		case OpTypeVector:
+			return getTypeSize(operands[1], NOT_DECORATED, depth + 1) * operands[2];
+
+		case OpTypeMatrix:
+		{
+			uint32_t columnSize = matrixStride != NOT_DECORATED ? matrixStride : getTypeSize(operands[1], NOT_DECORATED, depth + 1);
+			return columnSize * operands[2];
+		}
+
+		case OpTypeArray:
+		{
+			uint32_t stride = m_decorations[typeId].m_arrayStride;
+			if (stride == NOT_DECORATED)
+			{
+				stride = getTypeSize(operands[1], matrixStride, depth + 1);
+			}
+			return stride * getConstant(operands[2]);
+		}
+
+		case OpTypeRuntimeArray:
+			return 0;
+
+		case OpTypeStruct:
+		{
+			const std::vector<MemberDecorations>& members = m_memberDecorations[typeId];
+			uint32_t size = 0;
+			for (size_t i = 1; i < operands.size(); i++)
+			{
+				MemberDecorations member = i - 1 < members.size() ? members[i - 1] : MemberDecorations();
+				size = std::max(size, member.m_offset + getTypeSize(operands[i], member.m_matrixStride, depth + 1));
+			}
+			return size;
+		}
+
+		default:
+			fail("type %" + std::to_string(typeId) + " has no size");
+		}
+	}
+
+	VkFormat SpirvModule::getFormat(uint32_t typeId) const
+	{
+		const Definition* type = &getType(typeId);
+		uint32_t components = 1;
+		if (type->m_opcode == OpTypeVector)
+		{
+			components = type->m_operands[2];
+			type = &getType(type->m_operands[1]);
+		}
+
+		if ((type->m_opcode != OpTypeFloat && type->m_opcode != OpTypeInt) || type->m_operands[1] != 32 || components == 0 || components > 4)
+		{
+			fail("unsupported interface type %" + std::to_string(typeId));
+		}
+
+		static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (type->m_opcode == OpTypeFloat)
+		{
+			return floatFormats[components - 1];
+		}
+		return type->m_operands[2] != 0 ? intFormats[components - 1] : uintFormats[components - 1];
+	}
+
+	VkDescriptorType SpirvModule::getDescriptorType(uint32_t typeId, uint32_t storageClass) const
+	{
+		const Definition& type = getType(typeId);
+		if (storageClass == StorageClassStorageBuffer)
+		{
+			return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+		if (storageClass == StorageClassUniform)
+		{
+			// 旧版本的SPIR-V用BufferBlock修饰的Uniform块表示存储缓冲
+			return m_decorations[typeId].m_bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		}
+
+		switch (type.m_opcode)
+		{
+		case OpTypeSampler:
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+		case OpTypeSampledImage:
+			return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		case OpTypeImage:
+		{
+			uint32_t dim = type.m_operands[2];
+			uint32_t sampled = type.m_operands[6];
+			if (dim == DIM_SUBPASS_DATA)
+			{
+				return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+			if (dim == DIM_BUFFER)
+			{
+				return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+
+		default:
+			fail("unsupported descriptor type %" + std::to_string(typeId));
+		}
+	}
+
+	void SpirvModule::addInterfaceVariable(uint32_t variable, uint32_t typeId, std::vector<ShaderInterfaceVariable>& variables) const
+	{
+		// gl_Position等内建变量不占用location
+		if (m_decorations[variable].m_builtIn ||
+			(getType(typeId).m_opcode == OpTypeStruct && hasBuiltInMember(typeId)))
+		{
+			return;
+		}
+		if (m_decorations[variable].m_location == NOT_DECORATED)
+		{
+			fail(m_names[variable] + " has no location");
+		}
+
+		ShaderInterfaceVariable interfaceVariable;
+		interfaceVariable.m_location = m_decorations[variable].m_location;
+		interfaceVariable.m_format = getFormat(typeId);
+		interfaceVariable.m_name = m_names[variable];
+		variables.push_back(interfaceVariable);
+	}
+
+	ShaderReflection SpirvModule::reflect() const
+	{
+		ShaderReflection reflection;
+		reflection.m_entryPoint = m_entryPoint;
+		switch (m_executionModel)
+		{
+		case 0: reflection.m_stage = VK_SHADER_STAGE_VERTEX_BIT; break;
+		case 1: reflection.m_stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT; break;
+		case 2: reflection.m_stage = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT; break;
+		case 3: reflection.m_stage = VK_SHADER_STAGE_GEOMETRY_BIT; break;
+		case 4: reflection.m_stage = VK_SHADER_STAGE_FRAGMENT_BIT; break;
+		case 5: reflection.m_stage = VK_SHADER_STAGE_COMPUTE_BIT; break;
+		default: fail("unsupported execution model " + std::to_string(m_executionModel));
+		}
+
+		for (uint32_t variable : m_variables)
+		{
+			const Definition& definition = m_definitions[variable];
+			uint32_t storageClass = definition.m_operands[2];
+			uint32_t typeId = getDefinition(definition.m_operands[0], OpTypePointer).m_operands[2];
+
+			switch (storageClass)
+			{
+			case StorageClassInput:
+			case StorageClassOutput:
+				// 只统计入口点用到的接口变量
+				if (std::find(m_interface.begin(), m_interface.end(), variable) != m_interface.end())
+				{
+					addInterfaceVariable(variable, typeId, storageClass == StorageClassInput ? reflection.m_inputs : reflection.m_outputs);
+				}
+				break;
+
+			case StorageClassUniformConstant:
+			case StorageClassUniform:
+			case StorageClassStorageBuffer:
+			{
+				ShaderDescriptorBinding binding;
+				binding.m_set = m_decorations[variable].m_set == NOT_DECORATED ? 0 : m_decorations[variable].m_set;
+				binding.m_binding = m_decorations[variable].m_binding;
+				binding.m_name = m_names[variable];
+				if (binding.m_binding == NOT_DECORATED)
+				{
+					fail(binding.m_name + " has no binding");
+				}
+
+				const Definition& type = getType(typeId);
+				if (type.m_opcode == OpTypeArray)
+				{
+					binding.m_count = getConstant(type.m_operands[2]);
+					typeId = type.m_operands[1];
+				}
+				else if (type.m_opcode == OpTypeRuntimeArray)
+				{
+					binding.m_count = 0;
+					typeId = type.m_operands[1];
+				}
+				binding.m_type = getDescriptorType(typeId, storageClass);
+				reflection.m_descriptorBindings.push_back(binding);
+				break;
+			}
+
+			case StorageClassPushConstant:
+			{
+				// 推送常量范围从第一个成员的偏移开始，前面未使用的部分可以留给其他阶段
+				const Definition& type = getDefinition(typeId, OpTypeStruct);
+				const std::vector<MemberDecorations>& members = m_memberDecorations[typeId];
+				uint32_t begin = UINT32_MAX;
+				for (size_t i = 0; i + 1 < type.m_operands.size(); i++)
+				{
+					begin = std::min(begin, i < members.size() ? members[i].m_offset : 0);
+				}
+				uint32_t end = getTypeSize(typeId, NOT_DECORATED);
+				reflection.m_pushConstantOffset = begin == UINT32_MAX ? 0 : begin;
+				reflection.m_pushConstantSize = end - reflection.m_pushConstantOffset;
+				break;
+			}
+
+			default:
+				break;
+			}
+		}
+
+		for (uint32_t specConstant : m_specConstants)
+		{
+			if (m_decorations[specConstant].m_specId == NOT_DECORATED)
+			{
+				// 由其他特化常量计算出的常量没有SpecId
+				continue;
+			}
+
+			ShaderSpecializationConstant constant;
+			constant.m_constantId = m_decorations[specConstant].m_specId;
+			constant.m_name = m_names[specConstant];
+			reflection.m_specializationConstants.push_back(constant);
+		}
+
+		std::sort(reflection.m_inputs.begin(), reflection.m_inputs.end(),
+			[](const ShaderInterfaceVariable& a, const ShaderInterfaceVariable& b) { return a.m_location < b.m_location; });
+		std::sort(reflection.m_outputs.begin(), reflection.m_outputs.end(),
+			[](const ShaderInterfaceVariable& a, const ShaderInterfaceVariable& b) { return a.m_location < b.m_location; });
+		std::sort(reflection.m_descriptorBindings.begin(), reflection.m_descriptorBindings.end(),
+			[](const ShaderDescriptorBinding& a, const ShaderDescriptorBinding& b)
+			{
+				return a.m_set != b.m_set ? a.m_set < b.m_set : a.m_binding < b.m_binding;
+			});
+		std::sort(reflection.m_specializationConstants.begin(), reflection.m_specializationConstants.end(),
+			[](const ShaderSpecializationConstant& a, const ShaderSpecializationConstant& b) { return a.m_constantId < b.m_constantId; });
+		return reflection;
+	}
+}
+
+ShaderReflection reflectShader(const void* code, size_t size)
+{
+	return SpirvModule(code, size).reflect();
+}
+
+uint32_t buildVertexInput(const ShaderReflection& reflection, uint32_t binding, std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+	attributes.clear();
+
+	uint32_t offset = 0;
+	for (const auto& input : reflection.m_inputs)
+	{
+		VkVertexInputAttributeDescription attribute = {};
+		attribute.binding = binding;
+		attribute.location = input.m_location;
+		attribute.format = input.m_format;
+		attribute.offset = offset;
+		attributes.push_back(attribute);
+
+		offset += getFormatSize(input.m_format);
+	}
+	return offset;
+}
+
+uint32_t getFormatSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R32_SFLOAT:
+	case VK_FORMAT_R32_SINT:
+	case VK_FORMAT_R32_UINT:
+		return 4;
+	case VK_FORMAT_R32G32_SFLOAT:
+	case VK_FORMAT_R32G32_SINT:
+	case VK_FORMAT_R32G32_UINT:
+		return 8;
+	case VK_FORMAT_R32G32B32_SFLOAT:
+	case VK_FORMAT_R32G32B32_SINT:
+	case VK_FORMAT_R32G32B32_UINT:
+		return 12;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+	case VK_FORMAT_R32G32B32A32_SINT:
+	case VK_FORMAT_R32G32B32A32_UINT:
+		return 16;
+	default:
+		throw std::runtime_error("unsupported vertex format!");
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief 着色器的一个输入或输出变量，不包括内建变量
+ */
+struct ShaderInterfaceVariable
+{
+	uint32_t m_location = 0;
+	VkFormat m_format = VK_FORMAT_UNDEFINED;
+	std::string m_name;
+};
+
+/**
+ * \brief 着色器使用的一个描述符绑定
+ */
+struct ShaderDescriptorBinding
+{
+	uint32_t m_set = 0;
+	uint32_t m_binding = 0;
+	VkDescriptorType m_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+	// 数组的元素个数，不是数组时为1，运行时大小的数组为0
+	uint32_t m_count = 1;
+
+	std::string m_name;
+};
+
+/**
+ * \brief 着色器声明的一个特化常量，Vulkan中总是按4字节传入
+ */
+struct ShaderSpecializationConstant
+{
+	uint32_t m_constantId = 0;
+	std::string m_name;
+};
+
+/**
+ * \brief 从SPIR-V中读出的着色器接口
+ */
+struct ShaderReflection
+{
+	VkShaderStageFlagBits m_stage = VK_SHADER_STAGE_VERTEX_BIT;
+	std::string m_entryPoint;
+
+	// 按location递增排列
+	std::vector<ShaderInterfaceVariable> m_inputs;
+	std::vector<ShaderInterfaceVariable> m_outputs;
+
+	// 按set和binding递增排列
+	std::vector<ShaderDescriptorBinding> m_descriptorBindings;
+
+	// 推送常量块实际用到的字节范围，没有推送常量块时大小为0
+	uint32_t m_pushConstantOffset = 0;
+	uint32_t m_pushConstantSize = 0;
+
+	// 按constant_id递增排列
+	std::vector<ShaderSpecializationConstant> m_specializationConstants;
+};
+
+/**
+ * \brief 解析一个着色器模块的SPIR-V，只处理第一个入口点
+ * \param code 必须按4字节对齐
+ * \param size 字节数
+ * \return
+ */
+ShaderReflection reflectShader(const void* code, size_t size);
+
+/**
+ * \brief 按顶点着色器的输入生成一个紧密排列的顶点绑定，属性按location顺序依次存放
+ * \param reflection 顶点着色器的反射结果
+ * \param binding 顶点缓冲的绑定号
+ * \param attributes 生成的属性描述
+ * \return 一个顶点的字节数
+ */
+uint32_t buildVertexInput(const ShaderReflection& reflection, uint32_t binding, std::vector<VkVertexInputAttributeDescription>& attributes);
+
+/**
+ * \brief 格式占用的字节数，只支持着色器接口上出现的32位格式
+ * \param format
+ * \return
+ */
+uint32_t getFormatSize(VkFormat format);
@@ -0,0 +1,150 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Hash.h"
+
+void SpecializationConstants::set(uint32_t constantId, uint32_t value)
+{
+	auto it = std::lower_bound(m_entries.begin(), m_entries.end(), constantId,
+		[](const VkSpecializationMapEntry& entry, uint32_t id) { return entry.constantID < id; });
+
+	size_t index = static_cast<size_t>(it - m_entries.begin());
+	if (it != m_entries.end() && it->constantID == constantId)
+	{
+		m_data[index] = value;
+		return;
+	}
+
+	m_entries.insert(it, VkSpecializationMapEntry());
+	m_data.insert(m_data.begin() + index, value);
+
+	// 插入之后重新计算偏移，数据与条目一一对应
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		m_entries[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));
+		m_entries[i].size = sizeof(uint32_t);
+	}
+	m_entries[index].constantID = constantId;
+}
+
+void SpecializationConstants::setFloat(uint32_t constantId, float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	set(constantId, bits);
+}
+
+void SpecializationConstants::fillInfo(VkSpecializationInfo& info) const
+{
+	info.mapEntryCount = static_cast<uint32_t>(m_entries.size());
+	info.pMapEntries = m_entries.data();
+	info.dataSize = m_data.size() * sizeof(uint32_t);
+	info.pData = m_data.data();
+}
+
+uint64_t SpecializationConstants::hash(uint64_t seed) const
+{
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		seed = hashValue(m_entries[i].constantID, seed);
+		seed = hashValue(m_data[i], seed);
+	}
+	return seed;
+}
+
+bool SpecializationConstants::operator==(const SpecializationConstants& other) const
+{
+	if (m_entries.size() != other.m_entries.size() || m_data != other.m_data)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		if (m_entries[i].constantID != other.m_entries[i].constantID)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void ShaderVariantManifest::load(const std::string& path)
+{
+	m_variants.clear();
+
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream tokens(line);
+		std::string shader;
+		std::string variant;
+		if (!(tokens >> shader))
+		{
+			continue;
+		}
+		if (!(tokens >> variant))
+		{
+			throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": missing variant name!");
+		}
+
+		SpecializationConstants& constants = m_variants[shader][variant];
+		std::string assignment;
+		while (tokens >> assignment)
+		{
+			size_t equals = assignment.find('=');
+			if (equals == std::string::npos || equals == 0 || equals + 1 == assignment.size())
+			{
+				throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected constant_id=value, got " + assignment + "!");
+			}
+
+			uint32_t constantId = static_cast<uint32_t>(std::stoul(assignment.substr(0, equals)));
+			std::string value = assignment.substr(equals + 1);
+
+			// 带小数点的按float解释，其余按整数
+			if (value.find('.') != std::string::npos)
+			{
+				constants.setFloat(constantId, std::stof(value));
+			}
+			else
+			{
+				constants.set(constantId, static_cast<uint32_t>(std::stol(value)));
+			}
+		}
+	}
+}
+
+SpecializationConstants ShaderVariantManifest::get(const std::string& shader, const std::string& variant) const
+{
+	auto shaderIt = m_variants.find(shader);
+	if (shaderIt != m_variants.end())
+	{
+		auto variantIt = shaderIt->second.find(variant);
+		if (variantIt != shaderIt->second.end())
+		{
+			return variantIt->second;
+		}
+	}
+
+	// 没有列出的default变体使用着色器里的默认值
+	if (variant == "default")
+	{
+		return SpecializationConstants();
+	}
+	throw std::runtime_error("unknown shader variant " + shader + ":" + variant + "!");
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * \brief 一个着色器阶段的特化常量取值
+ *
+ * 所有值都按4字节保存，对应GLSL中的bool、int、uint和float特化常量。
+ * 同一份SPIR-V配上不同的取值，驱动会分别做常量折叠，不需要为每个变体编译一份二进制。
+ */
+class SpecializationConstants
+{
+public:
+	/**
+	 * \brief 设置一个常量，已经设置过时覆盖
+	 * \param constantId 着色器中的constant_id
+	 * \param value bool用0或1
+	 */
+	void set(uint32_t constantId, uint32_t value);
+
+	void setFloat(uint32_t constantId, float value);
+
+	bool empty() const
+	{
+		return m_entries.empty();
+	}
+
+	/**
+	 * \brief 填写特化信息，指针指向这个对象内部，对象修改或销毁之前有效
+	 * \param info
+	 */
+	void fillInfo(VkSpecializationInfo& info) const;
+
+	uint64_t hash(uint64_t seed) const;
+
+	bool operator==(const SpecializationConstants& other) const;
+
+	bool operator!=(const SpecializationConstants& other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	// 按constant_id递增排列，相同的取值总是得到相同的排列
+	std::vector<VkSpecializationMapEntry> m_entries;
+	std::vector<uint32_t> m_data;
+};
+
+/**
+ * \brief 着色器变体清单
+ *
+ * 文本文件，每行一个变体：源文件名、变体名和若干constant_id=值，#开始注释，例如
+ *     shader.frag grayscale 0=1
+ * 构建脚本按其中的源文件编译SPIR-V，程序按名称取出变体的特化常量。
+ */
+class ShaderVariantManifest
+{
+public:
+	/**
+	 * \brief 读取清单，文件不存在时只有隐含的default变体
+	 * \param path
+	 */
+	void load(const std::string& path);
+
+	/**
+	 * \brief 取出一个变体的特化常量，default变体没有列出时为空
+	 * \param shader 源文件名，例如shader.frag
+	 * \param variant
+	 * \return
+	 */
+	SpecializationConstants get(const std::string& shader, const std::string& variant) const;
+
+private:
+	// 源文件名 -> 变体名 -> 常量
+	std::map<std::string, std::map<std::string, SpecializationConstants>> m_variants;
+};
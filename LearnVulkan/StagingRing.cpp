@@ -0,0 +1,372 @@
+#include "StagingRing.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "QueueOwnership.h"
+
+namespace
+{
+	// 每次分配的对齐，满足vkCmdCopyBufferToImage对bufferOffset的要求（4的倍数且是常见像素大小的倍数）
+	const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+	/**
+	 * \brief 向上对齐
+	 * \param value
+	 * \param alignment 必须是2的幂
+	 * \return
+	 */
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+void StagingRing::init(VkDevice device, DeviceMemoryAllocator& allocator, VkQueue transferQueue,
+	uint32_t transferFamily, uint32_t graphicsFamily, VkDeviceSize frameSize, uint32_t frameCount)
+{
+	m_device = device;
+	m_allocator = &allocator;
+	m_transferQueue = transferQueue;
+	m_transferFamily = transferFamily;
+	m_graphicsFamily = graphicsFamily;
+	m_frameSize = alignUp(frameSize, STAGING_ALIGNMENT);
+	m_bytesUploaded = 0;
+	m_rejectedUploads = 0;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = m_frameSize * frameCount;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create staging ring buffer!");
+	}
+
+	m_memory = m_allocator->allocateForBuffer(m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (m_memory.m_mapped == nullptr)
+	{
+		throw std::runtime_error("failed to map staging ring buffer!");
+	}
+
+	m_regions.resize(frameCount);
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		FrameRegion& region = m_regions[i];
+		region.m_offset = m_frameSize * i;
+
+		// 每帧独立的命令池，回收区域时整体重置
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = m_transferFamily;
+
+		if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &region.m_commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create staging command pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = region.m_commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_device, &allocInfo, &region.m_commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate staging command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(m_device, &fenceInfo, nullptr, &region.m_fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create staging fence!");
+		}
+
+		if (isDedicatedTransfer())
+		{
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+			if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &region.m_semaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create staging semaphore!");
+			}
+		}
+	}
+
+	m_currentFrame = 0;
+}
+
+void StagingRing::destroy()
+{
+	for (FrameRegion& region : m_regions)
+	{
+		if (region.m_semaphore != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(m_device, region.m_semaphore, nullptr);
+		}
+		vkDestroyFence(m_device, region.m_fence, nullptr);
+		vkDestroyCommandPool(m_device, region.m_commandPool, nullptr);
+	}
+	m_regions.clear();
+
+	if (m_buffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_device, m_buffer, nullptr);
+		m_buffer = VK_NULL_HANDLE;
+	}
+	if (m_memory.isValid())
+	{
+		m_allocator->free(m_memory);
+	}
+}
+
+void StagingRing::beginFrame(uint32_t frameIndex)
+{
+	FrameRegion& region = m_regions[frameIndex];
+
+	// 初始化阶段录制的上传还没有提交，保留给这一帧
+	if (frameIndex == m_currentFrame && region.m_recording)
+	{
+		return;
+	}
+
+	m_currentFrame = frameIndex;
+
+	// 上一次使用该区域的复制完成后才能覆盖其中的数据
+	if (region.m_submitted)
+	{
+		vkWaitForFences(m_device, 1, &region.m_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		vkResetFences(m_device, 1, &region.m_fence);
+		region.m_submitted = false;
+	}
+
+	vkResetCommandPool(m_device, region.m_commandPool, 0);
+	region.m_head = 0;
+	region.m_recording = false;
+	region.m_bufferAcquires.clear();
+	region.m_imageAcquires.clear();
+	region.m_dstStages = 0;
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize& offset)
+{
+	if (size > m_frameSize)
+	{
+		throw std::runtime_error("upload is larger than the staging ring frame size!");
+	}
+
+	FrameRegion& region = m_regions[m_currentFrame];
+	VkDeviceSize head = alignUp(region.m_head, STAGING_ALIGNMENT);
+	if (head + size > m_frameSize)
+	{
+		m_rejectedUploads++;
+		return false;
+	}
+
+	offset = region.m_offset + head;
+	region.m_head = head + size;
+	m_bytesUploaded += size;
+	return true;
+}
+
+VkCommandBuffer StagingRing::getCommandBuffer()
+{
+	FrameRegion& region = m_regions[m_currentFrame];
+	if (!region.m_recording)
+	{
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(region.m_commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to begin recording staging command buffer!");
+		}
+		region.m_recording = true;
+	}
+	return region.m_commandBuffer;
+}
+
+bool StagingRing::uploadBuffer(const BufferUpload& upload)
+{
+	VkDeviceSize offset = 0;
+	if (!allocate(upload.m_size, offset))
+	{
+		return false;
+	}
+
+	memcpy(static_cast<char*>(m_memory.m_mapped) + offset, upload.m_data, static_cast<size_t>(upload.m_size));
+
+	VkCommandBuffer commandBuffer = getCommandBuffer();
+
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = offset;
+	copyRegion.dstOffset = upload.m_dstOffset;
+	copyRegion.size = upload.m_size;
+	vkCmdCopyBuffer(commandBuffer, m_buffer, upload.m_buffer, 1, &copyRegion);
+
+	FrameRegion& region = m_regions[m_currentFrame];
+	region.m_dstStages |= upload.m_dstStage;
+
+	if (isDedicatedTransfer())
+	{
+		// 在传输队列上释放所有权，图形队列在recordAcquireBarriers中获取
+		releaseBufferOwnership(commandBuffer, upload.m_buffer, upload.m_dstOffset, upload.m_size,
+			m_transferFamily, m_graphicsFamily, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		region.m_bufferAcquires.push_back(makeBufferAcquireBarrier(upload.m_buffer, upload.m_dstOffset, upload.m_size,
+			m_transferFamily, m_graphicsFamily, upload.m_dstAccess));
+	}
+	else
+	{
+		// 同一个队列，屏障对之后提交的命令同样生效
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = upload.m_dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = upload.m_buffer;
+		barrier.offset = upload.m_dstOffset;
+		barrier.size = upload.m_size;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, upload.m_dstStage,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	return true;
+}
+
+bool StagingRing::uploadImage(const ImageUpload& upload)
+{
+	VkDeviceSize offset = 0;
+	if (!allocate(upload.m_size, offset))
+	{
+		return false;
+	}
+
+	memcpy(static_cast<char*>(m_memory.m_mapped) + offset, upload.m_data, static_cast<size_t>(upload.m_size));
+
+	VkCommandBuffer commandBuffer = getCommandBuffer();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = upload.m_image;
+	barrier.subresourceRange.aspectMask = upload.m_aspectMask;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	// 原有内容不需要保留，直接从UNDEFINED转换
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = offset;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+	copyRegion.imageSubresource.aspectMask = upload.m_aspectMask;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageOffset = { 0, 0, 0 };
+	copyRegion.imageExtent = upload.m_extent;
+	vkCmdCopyBufferToImage(commandBuffer, m_buffer, upload.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+	FrameRegion& region = m_regions[m_currentFrame];
+	region.m_dstStages |= upload.m_dstStage;
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = upload.m_finalLayout;
+
+	if (isDedicatedTransfer())
+	{
+		// 释放和获取两边的布局转换必须一致
+		releaseImageOwnership(commandBuffer, upload.m_image, barrier.subresourceRange, barrier.oldLayout, barrier.newLayout,
+			m_transferFamily, m_graphicsFamily, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		region.m_imageAcquires.push_back(makeImageAcquireBarrier(upload.m_image, barrier.subresourceRange, barrier.oldLayout, barrier.newLayout,
+			m_transferFamily, m_graphicsFamily, upload.m_dstAccess));
+	}
+	else
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = upload.m_dstAccess;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, upload.m_dstStage,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	return true;
+}
+
+VkSemaphore StagingRing::submit(VkPipelineStageFlags& waitStages)
+{
+	waitStages = 0;
+
+	FrameRegion& region = m_regions[m_currentFrame];
+	if (!region.m_recording)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	if (vkEndCommandBuffer(region.m_commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record staging command buffer!");
+	}
+	region.m_recording = false;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &region.m_commandBuffer;
+
+	if (isDedicatedTransfer())
+	{
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &region.m_semaphore;
+	}
+
+	if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, region.m_fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit staging command buffer!");
+	}
+	region.m_submitted = true;
+
+	if (!isDedicatedTransfer())
+	{
+		// 同一个队列按提交顺序执行，录制时的屏障已经足够
+		return VK_NULL_HANDLE;
+	}
+
+	waitStages = region.m_dstStages;
+	return region.m_semaphore;
+}
+
+void StagingRing::recordAcquireBarriers(VkCommandBuffer commandBuffer)
+{
+	FrameRegion& region = m_regions[m_currentFrame];
+	if (region.m_bufferAcquires.empty() && region.m_imageAcquires.empty())
+	{
+		return;
+	}
+
+	// 源阶段与信号量等待的阶段一致，保证获取发生在复制完成之后
+	vkCmdPipelineBarrier(commandBuffer, region.m_dstStages, region.m_dstStages, 0,
+		0, nullptr,
+		static_cast<uint32_t>(region.m_bufferAcquires.size()), region.m_bufferAcquires.data(),
+		static_cast<uint32_t>(region.m_imageAcquires.size()), region.m_imageAcquires.data());
+
+	region.m_bufferAcquires.clear();
+	region.m_imageAcquires.clear();
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+#include "DeviceMemoryAllocator.h"
+
+/**
+ * \brief 一次缓冲上传的描述
+ */
+struct BufferUpload
+{
+	// 目标缓冲，必须带有VK_BUFFER_USAGE_TRANSFER_DST_BIT
+	VkBuffer m_buffer = VK_NULL_HANDLE;
+
+	// 写入目标缓冲的偏移
+	VkDeviceSize m_dstOffset = 0;
+
+	// 源数据
+	const void* m_data = nullptr;
+
+	// 字节数
+	VkDeviceSize m_size = 0;
+
+	// 上传完成后第一次使用缓冲的阶段和方式
+	VkPipelineStageFlags m_dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+	VkAccessFlags m_dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+};
+
+/**
+ * \brief 一次图像上传的描述，只覆盖第一个mip层级和数组层
+ */
+struct ImageUpload
+{
+	// 目标图像，必须带有VK_IMAGE_USAGE_TRANSFER_DST_BIT，原有内容会被丢弃
+	VkImage m_image = VK_NULL_HANDLE;
+
+	// 紧密排列的像素数据
+	const void* m_data = nullptr;
+
+	// 字节数
+	VkDeviceSize m_size = 0;
+
+	VkExtent3D m_extent = { 0, 0, 1 };
+
+	VkImageAspectFlags m_aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+	// 上传完成后的布局，以及第一次使用图像的阶段和方式
+	VkImageLayout m_finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkPipelineStageFlags m_dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	VkAccessFlags m_dstAccess = VK_ACCESS_SHADER_READ_BIT;
+};
+
+/**
+ * \brief 持久映射的暂存环形缓冲
+ *
+ * 每个飞行中的帧拥有环中的一段区域，帧内的上传用指针递增的方式在区域内分配，
+ * 复制命令批量录制后一次提交到传输队列。区域在该帧的传输栅栏触发后整体回收，
+ * 不需要为每次上传创建临时缓冲，也不需要vkQueueWaitIdle。
+ */
+class StagingRing
+{
+public:
+	StagingRing() = default;
+
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	/**
+	 * \brief 初始化
+	 * \param device
+	 * \param allocator 用于分配环形缓冲的内存
+	 * \param transferQueue 执行复制的队列
+	 * \param transferFamily 传输队列族
+	 * \param graphicsFamily 使用上传结果的图形队列族
+	 * \param frameSize 每帧区域的字节数
+	 * \param frameCount 飞行中的帧数
+	 */
+	void init(VkDevice device, DeviceMemoryAllocator& allocator, VkQueue transferQueue,
+		uint32_t transferFamily, uint32_t graphicsFamily, VkDeviceSize frameSize, uint32_t frameCount);
+
+	/**
+	 * \brief 销毁所有资源，调用前设备应该已经空闲
+	 */
+	void destroy();
+
+	/**
+	 * \brief 开始一帧的上传，等待该帧区域上一次的传输完成后回收整个区域
+	 * \param frameIndex
+	 */
+	void beginFrame(uint32_t frameIndex);
+
+	/**
+	 * \brief 把缓冲上传录制到当前帧
+	 * \param upload
+	 * \return 当前帧区域剩余空间不足时返回false，可以在下一帧重试
+	 */
+	bool uploadBuffer(const BufferUpload& upload);
+
+	/**
+	 * \brief 把图像上传录制到当前帧
+	 * \param upload
+	 * \return 当前帧区域剩余空间不足时返回false，可以在下一帧重试
+	 */
+	bool uploadImage(const ImageUpload& upload);
+
+	/**
+	 * \brief 提交当前帧录制的所有复制
+	 * \param waitStages 返回图形队列等待信号量的阶段
+	 * \return 图形队列需要等待的信号量，不需要等待时返回VK_NULL_HANDLE
+	 */
+	VkSemaphore submit(VkPipelineStageFlags& waitStages);
+
+	/**
+	 * \brief 在图形命令缓冲中录制获取所有权的屏障，必须在渲染流程之外调用
+	 * \param commandBuffer 当前帧的图形命令缓冲
+	 */
+	void recordAcquireBarriers(VkCommandBuffer commandBuffer);
+
+	/**
+	 * \brief 每帧区域的字节数
+	 * \return
+	 */
+	VkDeviceSize getFrameSize() const
+	{
+		return m_frameSize;
+	}
+
+	/**
+	 * \brief 累计上传的字节数
+	 * \return
+	 */
+	VkDeviceSize getBytesUploaded() const
+	{
+		return m_bytesUploaded;
+	}
+
+	/**
+	 * \brief 因为区域已满而被拒绝的上传次数
+	 * \return
+	 */
+	uint64_t getRejectedUploads() const
+	{
+		return m_rejectedUploads;
+	}
+
+private:
+	/**
+	 * \brief 一帧独占的区域
+	 */
+	struct FrameRegion
+	{
+		// 区域在环形缓冲中的起始偏移
+		VkDeviceSize m_offset = 0;
+
+		// 区域内下一次分配的位置
+		VkDeviceSize m_head = 0;
+
+		VkCommandPool m_commandPool = VK_NULL_HANDLE;
+		VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+
+		// 该区域的复制完成时触发
+		VkFence m_fence = VK_NULL_HANDLE;
+
+		// 使用专用传输队列时，通知图形队列复制已完成
+		VkSemaphore m_semaphore = VK_NULL_HANDLE;
+
+		// 命令缓冲是否已经开始录制
+		bool m_recording = false;
+
+		// 是否有尚未确认完成的提交
+		bool m_submitted = false;
+
+		// 需要在图形队列上获取所有权的资源
+		std::vector<VkBufferMemoryBarrier> m_bufferAcquires;
+		std::vector<VkImageMemoryBarrier> m_imageAcquires;
+
+		// 使用上传结果的阶段
+		VkPipelineStageFlags m_dstStages = 0;
+	};
+
+	VkDevice m_device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* m_allocator = nullptr;
+
+	VkQueue m_transferQueue = VK_NULL_HANDLE;
+	uint32_t m_transferFamily = 0;
+	uint32_t m_graphicsFamily = 0;
+
+	VkBuffer m_buffer = VK_NULL_HANDLE;
+	MemoryAllocation m_memory;
+
+	VkDeviceSize m_frameSize = 0;
+	std::vector<FrameRegion> m_regions;
+
+	// 当前正在录制的帧
+	uint32_t m_currentFrame = 0;
+
+	VkDeviceSize m_bytesUploaded = 0;
+	uint64_t m_rejectedUploads = 0;
+
+	bool isDedicatedTransfer() const
+	{
+		return m_transferFamily != m_graphicsFamily;
+	}
+
+	bool allocate(VkDeviceSize size, VkDeviceSize& offset);
+	VkCommandBuffer getCommandBuffer();
+};
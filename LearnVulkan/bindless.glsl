@@ -0,0 +1,20 @@
+// 无绑定描述符表的着色器端声明，与BindlessTable一致，需要--bindless并且设备支持描述符索引。
+// 使用方法：#extension GL_GOOGLE_include_directive : require 之后 #include "bindless.glsl"，
+// 句柄（数组下标）通过推送常量传入，例如
+//     layout(push_constant) uniform DrawConstants { uint textureHandle; } draw;
+//     vec4 color = texture(bindlessTexture(draw.textureHandle), uv);
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define BINDLESS_SET 0
+#define BINDLESS_INVALID_HANDLE 0xFFFFFFFFu
+
+layout(set = BINDLESS_SET, binding = 0) uniform sampler2D bindlessTextures[];
+
+layout(set = BINDLESS_SET, binding = 1) readonly buffer BindlessBuffer
+{
+	uint words[];
+} bindlessBuffers[];
+
+// 句柄在一次绘制内可能不统一（例如来自顶点属性）时必须加nonuniformEXT
+#define bindlessTexture(handle) bindlessTextures[nonuniformEXT(handle)]
+#define bindlessBuffer(handle) bindlessBuffers[nonuniformEXT(handle)]
\ No newline at end of file
@@ -1,3 +1,6 @@
-C:\VulkanSDK\1.3.268.0\Bin\glslangValidator.exe -V shader.vert
-C:\VulkanSDK\1.3.268.0\Bin\glslangValidator.exe -V shader.frag
+if not defined GLSLANG_VALIDATOR set GLSLANG_VALIDATOR=%VULKAN_SDK%\Bin\glslangValidator.exe
+for /f "eol=# tokens=1" %%s in (shader_variants.txt) do "%GLSLANG_VALIDATOR%" -V %%s
+"%GLSLANG_VALIDATOR%" -V -DDRAW_DATA_UNIFORM_BUFFER shader.vert -o vert_ubo.spv
+"%GLSLANG_VALIDATOR%" -V -DBINDLESS shader.vert -o vert_bindless.spv
+"%GLSLANG_VALIDATOR%" -V -DDRAW_DATA_UNIFORM_BUFFER -DBINDLESS shader.vert -o vert_ubo_bindless.spv
 pause
\ No newline at end of file
@@ -0,0 +1,22 @@
+#!/bin/sh
+# 编译shader_variants.txt中列出的每个着色器源文件，输出vert.spv和frag.spv
+# 优先使用GLSLANG_VALIDATOR，其次是$VULKAN_SDK/bin下的，最后在PATH中查找
+set -e
+cd "$(dirname "$0")"
+
+GLSLANG="${GLSLANG_VALIDATOR:-}"
+if [ -z "$GLSLANG" ] && [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/glslangValidator" ]; then
+	GLSLANG="$VULKAN_SDK/bin/glslangValidator"
+fi
+GLSLANG="${GLSLANG:-glslangValidator}"
+
+for source in $(sed -e 's/#.*//' shader_variants.txt | awk 'NF { print $1 }' | sort -u); do
+	"$GLSLANG" -V "$source"
+done
+
+# 推送常量放不下每个绘制的数据时程序改用动态uniform缓冲版本的顶点着色器
+"$GLSLANG" -V -DDRAW_DATA_UNIFORM_BUFFER shader.vert -o vert_ubo.spv
+
+# 无绑定模式下的顶点着色器按推送常量中的材质句柄读取无绑定缓冲数组
+"$GLSLANG" -V -DBINDLESS shader.vert -o vert_bindless.spv
+"$GLSLANG" -V -DDRAW_DATA_UNIFORM_BUFFER -DBINDLESS shader.vert -o vert_ubo_bindless.spv
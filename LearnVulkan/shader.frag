@@ -1,11 +1,28 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// 特化常量，创建管线时由VkSpecializationInfo覆盖，驱动按取值折叠掉无用的分支和循环
+layout(constant_id = 0) const bool GRAYSCALE = false;
+layout(constant_id = 1) const int EXTRA_ALU_ITERATIONS = 0;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-	outColor = vec4(fragColor, 1.0);
+	vec3 color = fragColor;
+
+	// 不改变结果的额外运算，用来模拟更重的片元着色器
+	for (int i = 0; i < EXTRA_ALU_ITERATIONS; i++)
+	{
+		color = sqrt(color * color);
+	}
+
+	if (GRAYSCALE)
+	{
+		color = vec3(dot(color, vec3(0.299, 0.587, 0.114)));
+	}
+
+	outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -1,24 +1,49 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) out vec3 fragColor;
+// 无绑定模式下的vert_bindless.spv和vert_ubo_bindless.spv定义了BINDLESS，按材质句柄从无绑定缓冲数组读取材质
+#ifdef BINDLESS
+#extension GL_GOOGLE_include_directive : require
+#include "bindless.glsl"
+#endif
+
+// 特化常量，创建管线时由VkSpecializationInfo覆盖
+layout(constant_id = 0) const float POSITION_SCALE = 1.0;
+
+// 每个绘制的数据，与HelloTriangleApplication.cpp中的DrawData一致。默认通过推送常量传入；
+// 超过设备的maxPushConstantsSize时程序换用定义了DRAW_DATA_UNIFORM_BUFFER的vert_ubo.spv，
+// 从每帧的动态uniform缓冲中按偏移读取
+#ifdef DRAW_DATA_UNIFORM_BUFFER
+layout(set = 1, binding = 0) uniform DrawData
+#else
+layout(push_constant) uniform DrawData
+#endif
+{
+	mat4 transform;
+	uint materialIndex;
+} draw;
 
-vec2 positions[3] = vec2[]
-(
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
 
-vec3 colors[3] = vec3[]
-(
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) out vec3 fragColor;
+
+#ifdef BINDLESS
+// 材质缓冲的开头是与HelloTriangleApplication.cpp中Material一致的颜色
+vec3 materialTint(uint handle)
+{
+	return vec3(uintBitsToFloat(bindlessBuffer(handle).words[0]),
+		uintBitsToFloat(bindlessBuffer(handle).words[1]),
+		uintBitsToFloat(bindlessBuffer(handle).words[2]));
+}
+#endif
 
 void main()
 {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	gl_Position = draw.transform * vec4(inPosition * POSITION_SCALE, 0.0, 1.0);
+#ifdef BINDLESS
+	fragColor = inColor * materialTint(draw.materialIndex);
+#else
+	fragColor = inColor;
+#endif
 }
\ No newline at end of file